@@ -1,34 +1,9 @@
 #include "apu.h"
 #include "channels.h"
 
+#include <algorithm>
 #include <bit>
 #include <iostream>
-#include <SDL2/SDL.h>
-
-void audio_callback(void *_apu, Uint8 *_stream, int _length) {
-    Apu *apu = (Apu*) _apu;
-    float *stream = (float*)_stream;
-    size_t length = (size_t)_length/sizeof(float);
-
-    if(apu->generated_samples >= length) {
-        apu->generated_samples -= length;
-    } else {
-        apu->generated_samples = 0;
-    }
-
-    size_t counter = 0;
-    size_t end = std::min(apu->output_buffer.size(), (size_t)length);
-
-    float next = 0;
-    while(counter < end) {
-        next = apu->output_buffer.front();
-        stream[counter++] = next;
-        apu->output_buffer.pop();
-    }
-    while(counter < length) {
-        stream[counter++] = 0;
-    }
-}
 
 void Apu::clock() {
 
@@ -42,12 +17,55 @@ void Apu::clock() {
         pulse2.ClockTimer();
     }
 
+    ClockFrameSequencer(1);
+    ClockSampler(1);
+}
+
+void Apu::RunCycles(uint32_t cycles) {
+    while(cycles > 0) {
+        // nothing but the timers changes until the next event, so they can
+        // be advanced in one go
+        uint32_t step = std::min(cycles, CyclesUntilEvent());
+
+        triangle.ClockTimer(step);
+        uint32_t pulse_clocks = (step + clock_counter%2) / 2;
+        pulse1.ClockTimer(pulse_clocks);
+        pulse2.ClockTimer(pulse_clocks);
+        clock_counter += step;
+
+        ClockFrameSequencer(step);
+        ClockSampler(step);
+        cycles -= step;
+    }
+}
+
+uint32_t Apu::CyclesUntilEvent() {
+    uint32_t frame_clock = FrameClock();
+    uint32_t until_frame_step = (cpu_frequency - frame_timer + frame_clock - 1) / frame_clock;
+    if(!output_enabled) {
+        return until_frame_step;
+    }
+    uint32_t until_sample = 1;
+    if(sample_timer < sample_period) {
+        until_sample = (sample_period - sample_timer + sample_frequency - 1) / sample_frequency;
+    }
+    return std::min(until_frame_step, until_sample);
+}
+
+void Apu::SetRateAdjustment(double adjustment) {
+    adjustment = std::clamp(adjustment, -max_rate_adjustment, max_rate_adjustment);
+    sample_period = (uint32_t)(cpu_frequency / (1.0 + adjustment) + 0.5);
+}
+
+uint32_t Apu::FrameClock() {
     // frame steps are clocked at ~240 hz in 4-step sequence mode
     // and ~192 Hz in 5-step sequence mode
-    uint32_t frame_clock = 192;
-    if(!five_step_sequence) frame_clock = 240;
+    if(five_step_sequence) return 192;
+    return 240;
+}
 
-    frame_timer += frame_clock;
+void Apu::ClockFrameSequencer(uint32_t cycles) {
+    frame_timer += FrameClock()*cycles;
     if(frame_timer >= cpu_frequency) {
         frame_timer -= cpu_frequency;
 
@@ -67,20 +85,26 @@ void Apu::clock() {
 
         ++frame_step;
     }
+}
 
+void Apu::ClockSampler(uint32_t cycles) {
+    sample_timer += sample_frequency*cycles;
+    if(!output_enabled) {
+        // samples nobody hears are not events, the timer only keeps its
+        // phase so output resumes where it would have been
+        sample_timer %= sample_period;
+        return;
+    }
+    if(sample_timer >= sample_period) {
+        sample_timer -= sample_period;
 
-    sample_timer += sample_frequency;
-    if(sample_timer >= cpu_frequency) {
-        sample_timer -= cpu_frequency;
-
-        generated_samples += 1;
-
-        SDL_LockAudioDevice(deviceId);
-        output_buffer.push( GetSample() );
-        SDL_UnlockAudioDevice(deviceId);
-
+        float sample = GetSample();
+        output_buffer.Write(&sample, 1);
     }
+}
 
+size_t Apu::ReadSamples(float *samples, size_t max_samples) {
+    return output_buffer.Read(samples, max_samples);
 }
 
 float Apu::GetSample() {
@@ -197,3 +221,27 @@ void Apu::writeRegister(const uint16_t &address, const uint8_t &value) {
             break;
     }
 }
+
+void Apu::SaveState(StateWriter &state) {
+    pulse1.SaveState(state);
+    pulse2.SaveState(state);
+    triangle.SaveState(state);
+
+    state.Write(clock_counter);
+    state.Write(sample_timer);
+    state.Write(frame_timer);
+    state.Write(five_step_sequence);
+    state.Write(frame_step);
+}
+
+void Apu::LoadState(StateReader &state) {
+    pulse1.LoadState(state);
+    pulse2.LoadState(state);
+    triangle.LoadState(state);
+
+    state.Read(clock_counter);
+    state.Read(sample_timer);
+    state.Read(frame_timer);
+    state.Read(five_step_sequence);
+    state.Read(frame_step);
+}
@@ -4,51 +4,58 @@
 #include <stdint.h>
 #include <bit>
 #include <iostream>
-#include <SDL2/SDL_audio.h>
-#include <queue>
-#include <atomic>
 
 #include "channels.h"
-
-void audio_callback(void *, Uint8*, int);
+#include "ringbuffer.h"
 
 class Apu {
     public:
         Apu() {
-            SDL_AudioSpec desiredSpec;
-
-            desiredSpec.freq = sample_frequency;
-            desiredSpec.format = AUDIO_F32SYS;
-            desiredSpec.channels = 1;
-            desiredSpec.samples = samples_per_callback;
-            desiredSpec.callback = audio_callback;
-            desiredSpec.userdata = this;
-
-            deviceId = SDL_OpenAudioDevice(NULL, 0, &desiredSpec, NULL, SDL_AUDIO_ALLOW_ANY_CHANGE);
-
             for(uint8_t i=0; i<32; ++i) {
                 pulse_table[i] = 95.52/(8128.0/((float)i) + 100.0);
             }
             for(uint8_t i=0; i<203; ++i) {
                 triangle_table[i] = 163.67/(24329.0/((float)i)+100);
             }
-
-            SDL_PauseAudioDevice(deviceId, 0);
-        }
-
-        ~Apu() {
-            SDL_CloseAudioDevice(deviceId);
         }
 
         void clock();
+
+        // Same as calling clock() cycles times, but the channel timers are
+        // advanced in one step between frame sequencer steps and samples
+        void RunCycles(uint32_t cycles);
+
+        // Number of CPU cycles until the next frame sequencer step or
+        // output sample, samples only count while output_enabled is set.
+        // Register writes are the only other events, the APU has to be
+        // caught up before them.
+        uint32_t CyclesUntilEvent();
+
+        // Generated samples that have not been read are not part of the state
+        void SaveState(StateWriter &state);
+        void LoadState(StateReader &state);
         void writeRegister(const uint16_t &address, const uint8_t &value);
 
-        std::queue<float> output_buffer;
+        // Moves up to max_samples generated samples into samples,
+        // returns the number of samples moved
+        size_t ReadSamples(float *samples, size_t max_samples);
+
+        // Generates samples up to max_rate_adjustment (0.5%) faster or slower
+        // than sample_frequency, for the frontend to keep its audio buffer
+        // filled while pacing video on its own clock. 0 is the exact rate.
+        void SetRateAdjustment(double adjustment);
+        static constexpr double max_rate_adjustment = 0.005;
 
-        SDL_AudioStream *stream;
+        // Number of generated samples that have not been read yet
+        size_t QueuedSamples() const { return output_buffer.Size(); }
 
-        std::atomic<uint32_t> generated_samples = 0;
-        const Uint16 samples_per_callback = 2048;
+        // When cleared, no samples are generated and the APU is only caught
+        // up for frame sequencer steps. Used while emulating
+        // frames that are thrown away again, such as run-ahead frames.
+        bool output_enabled = true;
+
+        const uint16_t samples_per_callback = 2048;
+        const int sample_frequency = 44100;
 
 
     private:
@@ -56,11 +63,18 @@ class Apu {
         Pulse pulse2 = Pulse(false);
         Triangle triangle;
 
+        // Generated samples, drained by whoever owns the audio output.
+        // clock() is the only producer and ReadSamples() the only consumer,
+        // which may run on the audio thread.
+        RingBuffer<float, 8192> output_buffer;
+
         uint32_t clock_counter = 0;
 
         uint32_t sample_timer = 0;
         const uint32_t cpu_frequency = 1789773;
-        const int sample_frequency = 44100;
+        // a sample is generated every time sample_timer passes this,
+        // cpu_frequency unless the rate is adjusted
+        uint32_t sample_period = cpu_frequency;
 
         uint32_t frame_timer = 0;
         bool five_step_sequence = 0;
@@ -71,11 +85,13 @@ class Apu {
 
         float GetSample();
 
+        uint32_t FrameClock();
+        void ClockFrameSequencer(uint32_t cycles);
+        void ClockSampler(uint32_t cycles);
+
         void ClockSweeps();
         void ClockEnvelopes();
         void ClockLengthCounters();
-
-        SDL_AudioDeviceID deviceId;
 };
 
 #endif // APU_H_INCLUDED
\ No newline at end of file
@@ -10,6 +10,11 @@ void Pulse::ClockTimer() {
     }
 }
 
+void Pulse::ClockTimer(uint32_t clocks) {
+    uint32_t steps = AdvanceTimer(timer, timer_reset, clocks);
+    sequence_index = (sequence_index+steps)%8;
+}
+
 void Pulse::ClockEnvelope() {
     envelope.clock();
 }
@@ -72,6 +77,11 @@ void Triangle::ClockTimer() {
     }
 }
 
+void Triangle::ClockTimer(uint32_t clocks) {
+    uint32_t steps = AdvanceTimer(timer, timer_reset, clocks);
+    position = (position+steps)%32;
+}
+
 void Triangle::ClockLengthCounter() {
     length_counter.clock();
 }
@@ -97,6 +107,20 @@ uint8_t Triangle::GetSample() {
     return sequence[position];
 }
 
+uint32_t AdvanceTimer(uint16_t &timer, const uint16_t &reset, uint32_t clocks) {
+    // a timer at 0 wraps around to 0xFFFF on its next clock
+    uint32_t until_reload = timer==0 ? 0x10000 : timer;
+    if(clocks < until_reload) {
+        timer -= clocks;
+        return 0;
+    }
+    clocks -= until_reload;
+
+    uint32_t period = reset==0 ? 0x10000 : reset;
+    timer = reset - (clocks % period);
+    return 1 + clocks/period;
+}
+
 void Envelope::clock() {
     if(start_flag) {
         start_flag = false; // the start flag is cleared
@@ -126,4 +150,98 @@ void LengthCounter::clock() {
     if(!is_halted && value>0) {
         --value;
     }
-}
\ No newline at end of file
+}
+
+void Pulse::SaveState(StateWriter &state) {
+    envelope.SaveState(state);
+    length_counter.SaveState(state);
+
+    state.Write(enabled);
+    state.Write(is_constant);
+    state.Write(constant_volume);
+    for(bool step : sequence) {
+        state.Write(step);
+    }
+    state.Write(timer_reset);
+    state.Write(timer);
+    state.Write(sequence_index);
+    state.Write(sweep_enabled);
+    state.Write(sweep_divider_period);
+    state.Write(sweep_divider_counter);
+    state.Write(sweep_negated);
+    state.Write(sweep_shift_count);
+    state.Write(sweep_reload);
+}
+
+void Pulse::LoadState(StateReader &state) {
+    envelope.LoadState(state);
+    length_counter.LoadState(state);
+
+    state.Read(enabled);
+    state.Read(is_constant);
+    state.Read(constant_volume);
+    for(bool &step : sequence) {
+        state.Read(step);
+    }
+    state.Read(timer_reset);
+    state.Read(timer);
+    state.Read(sequence_index);
+    state.Read(sweep_enabled);
+    state.Read(sweep_divider_period);
+    state.Read(sweep_divider_counter);
+    state.Read(sweep_negated);
+    state.Read(sweep_shift_count);
+    state.Read(sweep_reload);
+}
+
+void Triangle::SaveState(StateWriter &state) {
+    length_counter.SaveState(state);
+
+    state.Write(timer_reset);
+    state.Write(timer);
+    state.Write(counter_reload_value);
+    state.Write(counter_value);
+    state.Write(counter_on);
+    state.Write(counter_reload);
+    state.Write(enabled);
+    state.Write(position);
+}
+
+void Triangle::LoadState(StateReader &state) {
+    length_counter.LoadState(state);
+
+    state.Read(timer_reset);
+    state.Read(timer);
+    state.Read(counter_reload_value);
+    state.Read(counter_value);
+    state.Read(counter_on);
+    state.Read(counter_reload);
+    state.Read(enabled);
+    state.Read(position);
+}
+
+void Envelope::SaveState(StateWriter &state) {
+    state.Write(start_flag);
+    state.Write(decay_level);
+    state.Write(divider_step);
+    state.Write(reset_level);
+    state.Write(is_looping);
+}
+
+void Envelope::LoadState(StateReader &state) {
+    state.Read(start_flag);
+    state.Read(decay_level);
+    state.Read(divider_step);
+    state.Read(reset_level);
+    state.Read(is_looping);
+}
+
+void LengthCounter::SaveState(StateWriter &state) {
+    state.Write(value);
+    state.Write(is_halted);
+}
+
+void LengthCounter::LoadState(StateReader &state) {
+    state.Read(value);
+    state.Read(is_halted);
+}
@@ -4,9 +4,17 @@
 #include <array>
 #include <stdint.h>
 
+#include "savestate.h"
+
+// Advances a timer that counts down to zero and is then reloaded with
+// reset, by clocks clocks. Returns the number of times it was reloaded.
+uint32_t AdvanceTimer(uint16_t &timer, const uint16_t &reset, uint32_t clocks);
+
 class Envelope {
     public:
         void clock();
+        void SaveState(StateWriter &state);
+        void LoadState(StateReader &state);
 
         bool start_flag=false;
 
@@ -19,6 +27,8 @@ class Envelope {
 class LengthCounter {
     public:
         void clock();
+        void SaveState(StateWriter &state);
+        void LoadState(StateReader &state);
         void SetValue(const uint8_t &value) {
             this->value = length_counter_table[value];
         }
@@ -36,10 +46,13 @@ class Pulse {
     public:
         Pulse(bool is_channel_1){this->is_channel_1=is_channel_1;}
         void ClockTimer();
+        void ClockTimer(uint32_t clocks); // same as calling ClockTimer() clocks times
         void ClockEnvelope();
         void ClockLengthCounter();
         void ClockSweep();
         uint8_t GetSample();
+        void SaveState(StateWriter &state);
+        void LoadState(StateReader &state);
 
         Envelope envelope;
         LengthCounter length_counter;
@@ -68,9 +81,12 @@ class Pulse {
 class Triangle {
     public:
         void ClockTimer();
+        void ClockTimer(uint32_t clocks); // same as calling ClockTimer() clocks times
         void ClockLengthCounter();
         void ClockLinearCounter();
         uint8_t GetSample();
+        void SaveState(StateWriter &state);
+        void LoadState(StateReader &state);
 
         LengthCounter length_counter;
 
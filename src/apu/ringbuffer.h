@@ -0,0 +1,77 @@
+#ifndef RINGBUFFER_H_INCLUDED
+#define RINGBUFFER_H_INCLUDED
+
+#include <stddef.h>
+#include <algorithm>
+#include <atomic>
+
+// Fixed capacity single-producer/single-consumer queue.
+// Write() may only be called from one thread and Read() from one other
+// thread, neither of them ever blocks. The indices only ever increase and
+// are wrapped with a mask, so Capacity has to be a power of two.
+template<typename T, size_t Capacity>
+class RingBuffer {
+    static_assert(Capacity > 0 && (Capacity & (Capacity-1)) == 0, "Capacity must be a power of two");
+
+    public:
+        // Copies up to count items into the buffer, returns the number of
+        // items copied. Items that do not fit are dropped.
+        size_t Write(const T *items, size_t count) {
+            size_t write = write_index.load(std::memory_order_relaxed);
+            if(Capacity - (write - cached_read_index) < count) {
+                cached_read_index = read_index.load(std::memory_order_acquire);
+            }
+            count = std::min(count, Capacity - (write - cached_read_index));
+
+            size_t start = write & (Capacity-1);
+            size_t first = std::min(count, Capacity - start);
+            std::copy(items, items+first, buffer+start);
+            std::copy(items+first, items+count, buffer);
+
+            write_index.store(write + count, std::memory_order_release);
+            return count;
+        }
+
+        // Moves up to max_count items out of the buffer, returns the number
+        // of items moved
+        size_t Read(T *items, size_t max_count) {
+            size_t read = read_index.load(std::memory_order_relaxed);
+            if(cached_write_index - read < max_count) {
+                cached_write_index = write_index.load(std::memory_order_acquire);
+            }
+            size_t count = std::min(max_count, cached_write_index - read);
+
+            size_t start = read & (Capacity-1);
+            size_t first = std::min(count, Capacity - start);
+            std::copy(buffer+start, buffer+start+first, items);
+            std::copy(buffer, buffer+(count-first), items+first);
+
+            read_index.store(read + count, std::memory_order_release);
+            return count;
+        }
+
+        // Number of items currently queued. Only a snapshot when the other
+        // side is running concurrently.
+        size_t Size() const {
+            size_t read = read_index.load(std::memory_order_acquire);
+            return write_index.load(std::memory_order_acquire) - read;
+        }
+
+        static constexpr size_t capacity = Capacity;
+
+    private:
+        static constexpr size_t cache_line_size = 64;
+
+        // The producer and consumer each own one cache line, so they only
+        // share a line when one side has to refresh its copy of the other
+        // side's index.
+        alignas(cache_line_size) std::atomic<size_t> write_index = 0;
+        size_t cached_read_index = 0;
+
+        alignas(cache_line_size) std::atomic<size_t> read_index = 0;
+        size_t cached_write_index = 0;
+
+        alignas(cache_line_size) T buffer[Capacity];
+};
+
+#endif // RINGBUFFER_H_INCLUDED
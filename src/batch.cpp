@@ -0,0 +1,44 @@
+#include "batch.h"
+
+static const size_t frame_size = 256*240;
+
+static size_t threadCount(size_t threads) {
+    if(threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    return threads > 0 ? threads : 1;
+}
+
+ConsoleBatch::ConsoleBatch(const std::string &rom, size_t count, const std::vector<uint16_t> &ram_addresses, size_t threads)
+    : ram_addresses(ram_addresses), frames(count*frame_size, 0), ram(count*ram_addresses.size(), 0), pool(threadCount(threads)) {
+
+    for(size_t i=0; i<count; ++i) {
+        FrameBuffer frame_buffer = { &frames[i*frame_size] };
+        std::unique_ptr<Console> console = Console::FromFile(rom, frame_buffer);
+        if( !console ) {
+            consoles.clear();
+            return;
+        }
+        console->cpu.apu.output_enabled = false;
+        consoles.push_back(std::move(console));
+    }
+}
+
+void ConsoleBatch::Step(const uint8_t *actions) {
+    pool.ParallelFor(consoles.size(), [this, actions](size_t index) {
+        StepConsole(index, actions[index]);
+    });
+}
+
+void ConsoleBatch::StepConsole(size_t index, uint8_t action) {
+    Console &console = *consoles[index];
+
+    setButtons(&console.GetController(0), action);
+
+    console.RunFrame();
+
+    uint8_t *ram_out = &ram[index*ram_addresses.size()];
+    for(size_t i=0; i<ram_addresses.size(); ++i) {
+        ram_out[i] = console.cpu.ram[ ram_addresses[i] % 0x800 ];
+    }
+}
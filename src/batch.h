@@ -0,0 +1,48 @@
+#ifndef BATCH_H_INCLUDED
+#define BATCH_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "console.h"
+#include "threadpool.h"
+
+// Many consoles running the same ROM, stepped one frame at a time in
+// parallel. All output goes into buffers allocated once up front:
+//   Frames()  count x 240 x 256 palette indices (0-63), one frame per console
+//   Ram()     count x ram_addresses.size() bytes of CPU RAM, read after
+//             every step
+// Audio is not generated.
+class ConsoleBatch {
+    public:
+        // threads = 0 uses one thread per hardware thread
+        ConsoleBatch(const std::string &rom, size_t count, const std::vector<uint16_t> &ram_addresses, size_t threads = 0);
+
+        // False if the ROM could not be loaded
+        bool IsValid() const { return !consoles.empty(); }
+
+        // Sets the controller 1 buttons of every console to actions[i] and
+        // emulates one frame. Bit 0 is A, then B, Select, Start, Up, Down,
+        // Left and Right.
+        void Step(const uint8_t *actions);
+
+        size_t Size() const { return consoles.size(); }
+        const uint8_t *Frames() const { return frames.data(); }
+        const uint8_t *Ram() const { return ram.data(); }
+
+        Console &GetConsole(size_t index) { return *consoles.at(index); }
+
+    private:
+        std::vector< std::unique_ptr<Console> > consoles;
+        std::vector<uint16_t> ram_addresses;
+        std::vector<uint8_t> frames;
+        std::vector<uint8_t> ram;
+        ThreadPool pool;
+
+        void StepConsole(size_t index, uint8_t action);
+};
+
+#endif // BATCH_H_INCLUDED
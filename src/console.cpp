@@ -0,0 +1,24 @@
+#include "console.h"
+#include "filereader.h"
+
+Console::Console(std::shared_ptr<Mapper> mapper, FrameBuffer frame_buffer)
+    : mapper(mapper), ppu(frame_buffer), cpu(&ppu, mapper) {
+}
+
+std::unique_ptr<Console> Console::FromFile(const std::string &filename, FrameBuffer frame_buffer) {
+    std::shared_ptr<Mapper> mapper = read_file(filename);
+    if( !mapper ) {
+        return NULL;
+    }
+    return std::make_unique<Console>(mapper, frame_buffer);
+}
+
+uint64_t Console::RunFrame() {
+    uint64_t instructions = 0;
+    uint current_frame = ppu.GetCurrentFrame();
+    while(current_frame == ppu.GetCurrentFrame()) {
+        cpu.fetchAndExecute();
+        instructions += 1;
+    }
+    return instructions;
+}
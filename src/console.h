@@ -0,0 +1,36 @@
+#ifndef CONSOLE_H_INCLUDED
+#define CONSOLE_H_INCLUDED
+
+#include <memory>
+#include <string>
+
+#include "controller.h"
+#include "cpu6502.h"
+#include "ppu2C02.h"
+#include "mappers/mapper.h"
+
+// A complete NES: the CPU with its APU and controller ports, the PPU and
+// the cartridge. Consoles share no state with each other, so any number of
+// them can be emulated on different threads at the same time.
+class Console {
+    public:
+        Console(std::shared_ptr<Mapper> mapper, FrameBuffer frame_buffer);
+
+        // Loads a ROM with read_file(), returns NULL if that fails
+        static std::unique_ptr<Console> FromFile(const std::string &filename, FrameBuffer frame_buffer);
+
+        Console(const Console&) = delete;
+        Console& operator=(const Console&) = delete;
+
+        // Emulates CPU instructions until the PPU starts a new frame,
+        // returns the number of instructions executed
+        uint64_t RunFrame();
+
+        Controller &GetController(int port) { return cpu.controllers.at(port); }
+
+        std::shared_ptr<Mapper> mapper;
+        PPU2C02state ppu;
+        CPU6502state cpu;
+};
+
+#endif // CONSOLE_H_INCLUDED
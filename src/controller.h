@@ -1,7 +1,6 @@
 #ifndef CONTROLLER_H_INCLUDED
 #define CONTROLLER_H_INCLUDED
 
-#include <SDL2/SDL.h>
 #include <stdint.h>
 
 struct Controller {
@@ -10,13 +9,15 @@ struct Controller {
     uint8_t previous_write;
 };
 typedef struct Controller Controller;
-extern Controller NES_Controller;
 
 int initController(Controller *controller);
 
-void handleInput(Controller *controller, SDL_Event *e);
-
 void writeController(Controller *controller, uint8_t data);
 uint8_t getNextButton(Controller *controller);
 
+// All 8 buttons as one byte: bit 0 is A, then B, Select, Start, Up, Down,
+// Left and Right
+uint8_t getButtons(Controller *controller);
+void setButtons(Controller *controller, uint8_t buttons);
+
 #endif // CONTROLLER_H_INCLUDED
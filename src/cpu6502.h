@@ -3,12 +3,18 @@
 
 #include <array>
 #include <memory>
+#include <string>
+#include <utility>
 
 #include <stdint.h>
+#include <stdio.h>
 
+#include "controller.h"
+#include "cpu6502opcodes.h"
 #include "filereader.h"
 #include "ppu2C02.h"
 #include "apu/apu.h"
+#include "savestate.h"
 
 class PPU2C02state;
 
@@ -42,6 +48,13 @@ class CPU6502state {
         //interrupts
         void NMI();
 
+        //debugging (implemented in cpu6502disassembler.cpp)
+        //when set, a nestest.log style line is written before every instruction
+        FILE *trace_file = NULL;
+        std::string TraceLine();
+        std::string Disassemble(uint16_t address);
+        uint8_t PeekRam(uint16_t address);
+
         //CPU addressing modes (implemented in cpu6502instructions.c)
         uint16_t addressImmediate();
         uint16_t addressZeroPage();
@@ -62,13 +75,61 @@ class CPU6502state {
 
         Apu apu;
 
+        // Controller ports 1 and 2, read through $4016 and $4017
+        std::array<Controller, 2> controllers;
+
         uint8_t done_render = 0;
 
+        uint64_t GetClockCycles() { return clock_cycle; }
+
+        // When set, the PPU is not stepped on every CPU cycle. It is only
+        // caught up when the CPU accesses it, or when an event the CPU can
+        // observe (NMI, a new frame) is due. Set before starting emulation.
+        bool catch_up_ppu = true;
+        void SyncPPU();
+
+        // When set, the APU is only caught up before register writes and
+        // when its next frame sequencer step or sample is due, instead of
+        // being clocked on every CPU cycle. Set before starting emulation.
+        bool catch_up_apu = true;
+        void SyncAPU();
+
+        // Save states (the connected PPU, APU and mapper are saved by
+        // SaveState() in savestate.cpp)
+        void SaveState(StateWriter &state);
+        void LoadState(StateReader &state);
+
     private:
-        uint clock_cycle = 0;
+        uint64_t clock_cycle = 0;
+
+        uint32_t ppu_pending_dots = 0;
+        uint32_t ppu_sync_deadline = 0;
+
+        uint32_t apu_pending_cycles = 0;
+        uint32_t apu_sync_deadline = 0;
 
         void Tick();
 
+        // Memory bus, one entry per 256 byte page. NULL entries are
+        // handled by ReadRegister()/WriteRegister().
+        std::array<const uint8_t*, 0x100> read_pages;
+        std::array<uint8_t*, 0x100> write_pages;
+        uint32_t mapped_prg_version = 0;
+        void MapPages();
+        void MapPrgPages();
+        uint8_t ReadRegister(uint16_t address);
+        uint8_t WriteRegister(uint16_t address, uint8_t value);
+
+        // Opcode dispatch, generated from opcode_table
+        typedef void (CPU6502state::*OpcodeHandler)();
+        static const std::array<OpcodeHandler, 256> opcode_handlers;
+        template<size_t... opcodes>
+        static constexpr std::array<OpcodeHandler, 256> makeOpcodeHandlers(std::index_sequence<opcodes...>);
+
+        template<uint8_t opcode> void Execute();
+        template<AddressingMode mode, bool dummy_cycle_first> uint16_t ResolveAddress();
+        template<Operation operation, AddressingMode mode> void Operate(const uint16_t &address);
+
         // Instructions (implemented in cpu6502instructions.c)
         void ADC(const uint16_t &address);
         void AND(const uint16_t &address);
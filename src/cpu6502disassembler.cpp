@@ -0,0 +1,61 @@
+#include <stdio.h>
+
+#include "cpu6502.h"
+#include "cpu6502opcodes.h"
+
+/******************
+* Reads memory without ticking the clock or touching any registers with side effects
+******************/
+uint8_t CPU6502state::PeekRam(uint16_t address) {
+    if(address <= 0x1FFF) {
+        return ram[address%0x0800];
+    }
+    else if (address >= 0x4020) {
+        return mapper->ReadPrg(address);
+    }
+    return 0;
+}
+
+/******************
+* Returns the instruction at address in assembler syntax, e.g. "LDA ($44),Y"
+******************/
+std::string CPU6502state::Disassemble(uint16_t address) {
+    const OpcodeInfo &info = opcode_table[PeekRam(address)];
+    uint8_t low = PeekRam(address+1);
+    uint8_t high = PeekRam(address+2);
+
+    char operand[16] = "";
+    switch(info.mode) {
+        case AddressingMode::Implied:         break;
+        case AddressingMode::Accumulator:     snprintf(operand, sizeof(operand), " A"); break;
+        case AddressingMode::Immediate:       snprintf(operand, sizeof(operand), " #$%02X", low); break;
+        case AddressingMode::ZeroPage:        snprintf(operand, sizeof(operand), " $%02X", low); break;
+        case AddressingMode::ZeroPageX:       snprintf(operand, sizeof(operand), " $%02X,X", low); break;
+        case AddressingMode::ZeroPageY:       snprintf(operand, sizeof(operand), " $%02X,Y", low); break;
+        case AddressingMode::Relative:        snprintf(operand, sizeof(operand), " $%04X", (uint16_t)(address + 2 + (int8_t)low)); break;
+        case AddressingMode::Absolute:        snprintf(operand, sizeof(operand), " $%02X%02X", high, low); break;
+        case AddressingMode::AbsoluteX:       snprintf(operand, sizeof(operand), " $%02X%02X,X", high, low); break;
+        case AddressingMode::AbsoluteY:       snprintf(operand, sizeof(operand), " $%02X%02X,Y", high, low); break;
+        case AddressingMode::Indirect:        snprintf(operand, sizeof(operand), " ($%02X%02X)", high, low); break;
+        case AddressingMode::IndexedIndirect: snprintf(operand, sizeof(operand), " ($%02X,X)", low); break;
+        case AddressingMode::IndirectIndexed: snprintf(operand, sizeof(operand), " ($%02X),Y", low); break;
+    }
+    return std::string(mnemonic(info.operation)) + operand;
+}
+
+/******************
+* Returns the instruction at PC and the current registers, in the format of nestest.log
+******************/
+std::string CPU6502state::TraceLine() {
+    uint8_t length = instructionLength(opcode_table[PeekRam(PC)].mode);
+
+    char bytes[16] = "";
+    for(uint8_t i=0; i<length; ++i) {
+        snprintf(bytes + 3*i, sizeof(bytes) - 3*i, "%02X ", PeekRam(PC+i));
+    }
+
+    char line[128];
+    snprintf(line, sizeof(line), "%04X  %-9s %-31s A:%02X X:%02X Y:%02X P:%02X SP:%02X CYC:%llu",
+             PC, bytes, Disassemble(PC).c_str(), A, X, Y, P, SP, (unsigned long long)clock_cycle);
+    return line;
+}
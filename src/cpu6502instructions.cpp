@@ -142,6 +142,8 @@ void CPU6502state::Branch(const uint16_t &address, const Flags &flag, bool shoul
 }
 
 void CPU6502state::BRK() {
+    // reads the padding byte after the opcode
+    Tick();
     pushStack(((PC+1) & 0xFF00) >> 8);
     pushStack((PC+1) & 0xFF);
     pushStack(P | (1<<UNDEFINED) | (1<<B));
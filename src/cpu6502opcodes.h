@@ -0,0 +1,320 @@
+#ifndef CPU6502OPCODES_H_INCLUDED
+#define CPU6502OPCODES_H_INCLUDED
+
+#include <array>
+#include <stdint.h>
+
+// Compile-time description of every opcode. The dispatcher in cpu6502.cpp
+// generates its handlers from this table, and the disassembler uses it to
+// decode instructions, so this is the only place opcodes are defined.
+
+enum class Operation : uint8_t {
+    ADC, AND, ASL, BCC, BCS, BEQ, BIT, BMI, BNE, BPL, BRK, BVC, BVS, CLC,
+    CLD, CLI, CLV, CMP, CPX, CPY, DEC, DEX, DEY, EOR, INC, INX, INY, JMP,
+    JSR, LDA, LDX, LDY, LSR, NOP, ORA, PHA, PHP, PLA, PLP, ROL, ROR, RTI,
+    RTS, SBC, SEC, SED, SEI, STA, STX, STY, TAX, TAY, TSX, TXA, TXS, TYA,
+
+    // unofficial opcodes
+    DCP, ISB, LAX, RLA, RRA, SAX, SLO, SRE
+};
+
+static constexpr const char *operation_mnemonics[] = {
+    "ADC", "AND", "ASL", "BCC", "BCS", "BEQ", "BIT", "BMI", "BNE", "BPL", "BRK", "BVC", "BVS", "CLC",
+    "CLD", "CLI", "CLV", "CMP", "CPX", "CPY", "DEC", "DEX", "DEY", "EOR", "INC", "INX", "INY", "JMP",
+    "JSR", "LDA", "LDX", "LDY", "LSR", "NOP", "ORA", "PHA", "PHP", "PLA", "PLP", "ROL", "ROR", "RTI",
+    "RTS", "SBC", "SEC", "SED", "SEI", "STA", "STX", "STY", "TAX", "TAY", "TSX", "TXA", "TXS", "TYA",
+
+    "DCP", "ISB", "LAX", "RLA", "RRA", "SAX", "SLO", "SRE"
+};
+
+enum class AddressingMode : uint8_t {
+    Implied, Accumulator, Immediate, ZeroPage, ZeroPageX, ZeroPageY, Relative,
+    Absolute, AbsoluteX, AbsoluteY, Indirect, IndexedIndirect, IndirectIndexed
+};
+
+struct OpcodeInfo {
+    Operation operation;
+    AddressingMode mode;
+    uint8_t cycles; // without page crossing and branch penalties, checked
+                    // against execution while tracing
+};
+
+struct OpcodeDefinition {
+    uint8_t opcode;
+    Operation operation;
+    AddressingMode mode;
+    uint8_t cycles;
+};
+
+static constexpr OpcodeDefinition opcode_definitions[] = {
+    {0x00, Operation::BRK, AddressingMode::Implied, 7},
+    {0x01, Operation::ORA, AddressingMode::IndexedIndirect, 6},
+    {0x03, Operation::SLO, AddressingMode::IndexedIndirect, 8},
+    {0x04, Operation::NOP, AddressingMode::ZeroPage, 3},
+    {0x05, Operation::ORA, AddressingMode::ZeroPage, 3},
+    {0x06, Operation::ASL, AddressingMode::ZeroPage, 5},
+    {0x07, Operation::SLO, AddressingMode::ZeroPage, 5},
+    {0x08, Operation::PHP, AddressingMode::Implied, 3},
+    {0x09, Operation::ORA, AddressingMode::Immediate, 2},
+    {0x0A, Operation::ASL, AddressingMode::Accumulator, 2},
+    {0x0C, Operation::NOP, AddressingMode::Absolute, 4},
+    {0x0D, Operation::ORA, AddressingMode::Absolute, 4},
+    {0x0E, Operation::ASL, AddressingMode::Absolute, 6},
+    {0x0F, Operation::SLO, AddressingMode::Absolute, 6},
+    {0x10, Operation::BPL, AddressingMode::Relative, 2},
+    {0x11, Operation::ORA, AddressingMode::IndirectIndexed, 5},
+    {0x13, Operation::SLO, AddressingMode::IndirectIndexed, 8},
+    {0x14, Operation::NOP, AddressingMode::ZeroPageX, 4},
+    {0x15, Operation::ORA, AddressingMode::ZeroPageX, 4},
+    {0x16, Operation::ASL, AddressingMode::ZeroPageX, 6},
+    {0x17, Operation::SLO, AddressingMode::ZeroPageX, 6},
+    {0x18, Operation::CLC, AddressingMode::Implied, 2},
+    {0x19, Operation::ORA, AddressingMode::AbsoluteY, 4},
+    {0x1B, Operation::SLO, AddressingMode::AbsoluteY, 7},
+    {0x1C, Operation::NOP, AddressingMode::AbsoluteX, 4},
+    {0x1D, Operation::ORA, AddressingMode::AbsoluteX, 4},
+    {0x1E, Operation::ASL, AddressingMode::AbsoluteX, 7},
+    {0x1F, Operation::SLO, AddressingMode::AbsoluteX, 7},
+    {0x20, Operation::JSR, AddressingMode::Absolute, 6},
+    {0x21, Operation::AND, AddressingMode::IndexedIndirect, 6},
+    {0x23, Operation::RLA, AddressingMode::IndexedIndirect, 8},
+    {0x24, Operation::BIT, AddressingMode::ZeroPage, 3},
+    {0x25, Operation::AND, AddressingMode::ZeroPage, 3},
+    {0x26, Operation::ROL, AddressingMode::ZeroPage, 5},
+    {0x27, Operation::RLA, AddressingMode::ZeroPage, 5},
+    {0x28, Operation::PLP, AddressingMode::Implied, 4},
+    {0x29, Operation::AND, AddressingMode::Immediate, 2},
+    {0x2A, Operation::ROL, AddressingMode::Accumulator, 2},
+    {0x2C, Operation::BIT, AddressingMode::Absolute, 4},
+    {0x2D, Operation::AND, AddressingMode::Absolute, 4},
+    {0x2E, Operation::ROL, AddressingMode::Absolute, 6},
+    {0x2F, Operation::RLA, AddressingMode::Absolute, 6},
+    {0x30, Operation::BMI, AddressingMode::Relative, 2},
+    {0x31, Operation::AND, AddressingMode::IndirectIndexed, 5},
+    {0x33, Operation::RLA, AddressingMode::IndirectIndexed, 8},
+    {0x34, Operation::NOP, AddressingMode::ZeroPageX, 4},
+    {0x35, Operation::AND, AddressingMode::ZeroPageX, 4},
+    {0x36, Operation::ROL, AddressingMode::ZeroPageX, 6},
+    {0x37, Operation::RLA, AddressingMode::ZeroPageX, 6},
+    {0x38, Operation::SEC, AddressingMode::Implied, 2},
+    {0x39, Operation::AND, AddressingMode::AbsoluteY, 4},
+    {0x3B, Operation::RLA, AddressingMode::AbsoluteY, 7},
+    {0x3C, Operation::NOP, AddressingMode::AbsoluteX, 4},
+    {0x3D, Operation::AND, AddressingMode::AbsoluteX, 4},
+    {0x3E, Operation::ROL, AddressingMode::AbsoluteX, 7},
+    {0x3F, Operation::RLA, AddressingMode::AbsoluteX, 7},
+    {0x40, Operation::RTI, AddressingMode::Implied, 6},
+    {0x41, Operation::EOR, AddressingMode::IndexedIndirect, 6},
+    {0x43, Operation::SRE, AddressingMode::IndexedIndirect, 8},
+    {0x44, Operation::NOP, AddressingMode::ZeroPage, 3},
+    {0x45, Operation::EOR, AddressingMode::ZeroPage, 3},
+    {0x46, Operation::LSR, AddressingMode::ZeroPage, 5},
+    {0x47, Operation::SRE, AddressingMode::ZeroPage, 5},
+    {0x48, Operation::PHA, AddressingMode::Implied, 3},
+    {0x49, Operation::EOR, AddressingMode::Immediate, 2},
+    {0x4A, Operation::LSR, AddressingMode::Accumulator, 2},
+    {0x4C, Operation::JMP, AddressingMode::Absolute, 3},
+    {0x4D, Operation::EOR, AddressingMode::Absolute, 4},
+    {0x4E, Operation::LSR, AddressingMode::Absolute, 6},
+    {0x4F, Operation::SRE, AddressingMode::Absolute, 6},
+    {0x50, Operation::BVC, AddressingMode::Relative, 2},
+    {0x51, Operation::EOR, AddressingMode::IndirectIndexed, 5},
+    {0x53, Operation::SRE, AddressingMode::IndirectIndexed, 8},
+    {0x54, Operation::NOP, AddressingMode::ZeroPageX, 4},
+    {0x55, Operation::EOR, AddressingMode::ZeroPageX, 4},
+    {0x56, Operation::LSR, AddressingMode::ZeroPageX, 6},
+    {0x57, Operation::SRE, AddressingMode::ZeroPageX, 6},
+    {0x58, Operation::CLI, AddressingMode::Implied, 2},
+    {0x59, Operation::EOR, AddressingMode::AbsoluteY, 4},
+    {0x5B, Operation::SRE, AddressingMode::AbsoluteY, 7},
+    {0x5C, Operation::NOP, AddressingMode::AbsoluteX, 4},
+    {0x5D, Operation::EOR, AddressingMode::AbsoluteX, 4},
+    {0x5E, Operation::LSR, AddressingMode::AbsoluteX, 7},
+    {0x5F, Operation::SRE, AddressingMode::AbsoluteX, 7},
+    {0x60, Operation::RTS, AddressingMode::Implied, 6},
+    {0x61, Operation::ADC, AddressingMode::IndexedIndirect, 6},
+    {0x63, Operation::RRA, AddressingMode::IndexedIndirect, 8},
+    {0x64, Operation::NOP, AddressingMode::ZeroPage, 3},
+    {0x65, Operation::ADC, AddressingMode::ZeroPage, 3},
+    {0x66, Operation::ROR, AddressingMode::ZeroPage, 5},
+    {0x67, Operation::RRA, AddressingMode::ZeroPage, 5},
+    {0x68, Operation::PLA, AddressingMode::Implied, 4},
+    {0x69, Operation::ADC, AddressingMode::Immediate, 2},
+    {0x6A, Operation::ROR, AddressingMode::Accumulator, 2},
+    {0x6C, Operation::JMP, AddressingMode::Indirect, 5},
+    {0x6D, Operation::ADC, AddressingMode::Absolute, 4},
+    {0x6E, Operation::ROR, AddressingMode::Absolute, 6},
+    {0x6F, Operation::RRA, AddressingMode::Absolute, 6},
+    {0x70, Operation::BVS, AddressingMode::Relative, 2},
+    {0x71, Operation::ADC, AddressingMode::IndirectIndexed, 5},
+    {0x73, Operation::RRA, AddressingMode::IndirectIndexed, 8},
+    {0x74, Operation::NOP, AddressingMode::ZeroPageX, 4},
+    {0x75, Operation::ADC, AddressingMode::ZeroPageX, 4},
+    {0x76, Operation::ROR, AddressingMode::ZeroPageX, 6},
+    {0x77, Operation::RRA, AddressingMode::ZeroPageX, 6},
+    {0x78, Operation::SEI, AddressingMode::Implied, 2},
+    {0x79, Operation::ADC, AddressingMode::AbsoluteY, 4},
+    {0x7B, Operation::RRA, AddressingMode::AbsoluteY, 7},
+    {0x7C, Operation::NOP, AddressingMode::AbsoluteX, 4},
+    {0x7D, Operation::ADC, AddressingMode::AbsoluteX, 4},
+    {0x7E, Operation::ROR, AddressingMode::AbsoluteX, 7},
+    {0x7F, Operation::RRA, AddressingMode::AbsoluteX, 7},
+    {0x80, Operation::NOP, AddressingMode::Immediate, 2},
+    {0x81, Operation::STA, AddressingMode::IndexedIndirect, 6},
+    {0x83, Operation::SAX, AddressingMode::IndexedIndirect, 6},
+    {0x84, Operation::STY, AddressingMode::ZeroPage, 3},
+    {0x85, Operation::STA, AddressingMode::ZeroPage, 3},
+    {0x86, Operation::STX, AddressingMode::ZeroPage, 3},
+    {0x87, Operation::SAX, AddressingMode::ZeroPage, 3},
+    {0x88, Operation::DEY, AddressingMode::Implied, 2},
+    {0x8A, Operation::TXA, AddressingMode::Implied, 2},
+    {0x8C, Operation::STY, AddressingMode::Absolute, 4},
+    {0x8D, Operation::STA, AddressingMode::Absolute, 4},
+    {0x8E, Operation::STX, AddressingMode::Absolute, 4},
+    {0x8F, Operation::SAX, AddressingMode::Absolute, 4},
+    {0x90, Operation::BCC, AddressingMode::Relative, 2},
+    {0x91, Operation::STA, AddressingMode::IndirectIndexed, 6},
+    {0x94, Operation::STY, AddressingMode::ZeroPageX, 4},
+    {0x95, Operation::STA, AddressingMode::ZeroPageX, 4},
+    {0x96, Operation::STX, AddressingMode::ZeroPageY, 4},
+    {0x97, Operation::SAX, AddressingMode::ZeroPageY, 4},
+    {0x98, Operation::TYA, AddressingMode::Implied, 2},
+    {0x99, Operation::STA, AddressingMode::AbsoluteY, 5},
+    {0x9A, Operation::TXS, AddressingMode::Implied, 2},
+    {0x9D, Operation::STA, AddressingMode::AbsoluteX, 5},
+    {0xA0, Operation::LDY, AddressingMode::Immediate, 2},
+    {0xA1, Operation::LDA, AddressingMode::IndexedIndirect, 6},
+    {0xA2, Operation::LDX, AddressingMode::Immediate, 2},
+    {0xA3, Operation::LAX, AddressingMode::IndexedIndirect, 6},
+    {0xA4, Operation::LDY, AddressingMode::ZeroPage, 3},
+    {0xA5, Operation::LDA, AddressingMode::ZeroPage, 3},
+    {0xA6, Operation::LDX, AddressingMode::ZeroPage, 3},
+    {0xA7, Operation::LAX, AddressingMode::ZeroPage, 3},
+    {0xA8, Operation::TAY, AddressingMode::Implied, 2},
+    {0xA9, Operation::LDA, AddressingMode::Immediate, 2},
+    {0xAA, Operation::TAX, AddressingMode::Implied, 2},
+    {0xAC, Operation::LDY, AddressingMode::Absolute, 4},
+    {0xAD, Operation::LDA, AddressingMode::Absolute, 4},
+    {0xAE, Operation::LDX, AddressingMode::Absolute, 4},
+    {0xAF, Operation::LAX, AddressingMode::Absolute, 4},
+    {0xB0, Operation::BCS, AddressingMode::Relative, 2},
+    {0xB1, Operation::LDA, AddressingMode::IndirectIndexed, 5},
+    {0xB3, Operation::LAX, AddressingMode::IndirectIndexed, 5},
+    {0xB4, Operation::LDY, AddressingMode::ZeroPageX, 4},
+    {0xB5, Operation::LDA, AddressingMode::ZeroPageX, 4},
+    {0xB6, Operation::LDX, AddressingMode::ZeroPageY, 4},
+    {0xB7, Operation::LAX, AddressingMode::ZeroPageY, 4},
+    {0xB8, Operation::CLV, AddressingMode::Implied, 2},
+    {0xB9, Operation::LDA, AddressingMode::AbsoluteY, 4},
+    {0xBA, Operation::TSX, AddressingMode::Implied, 2},
+    {0xBC, Operation::LDY, AddressingMode::AbsoluteX, 4},
+    {0xBD, Operation::LDA, AddressingMode::AbsoluteX, 4},
+    {0xBE, Operation::LDX, AddressingMode::AbsoluteY, 4},
+    {0xBF, Operation::LAX, AddressingMode::AbsoluteY, 4},
+    {0xC0, Operation::CPY, AddressingMode::Immediate, 2},
+    {0xC1, Operation::CMP, AddressingMode::IndexedIndirect, 6},
+    {0xC3, Operation::DCP, AddressingMode::IndexedIndirect, 8},
+    {0xC4, Operation::CPY, AddressingMode::ZeroPage, 3},
+    {0xC5, Operation::CMP, AddressingMode::ZeroPage, 3},
+    {0xC6, Operation::DEC, AddressingMode::ZeroPage, 5},
+    {0xC7, Operation::DCP, AddressingMode::ZeroPage, 5},
+    {0xC8, Operation::INY, AddressingMode::Implied, 2},
+    {0xC9, Operation::CMP, AddressingMode::Immediate, 2},
+    {0xCA, Operation::DEX, AddressingMode::Implied, 2},
+    {0xCC, Operation::CPY, AddressingMode::Absolute, 4},
+    {0xCD, Operation::CMP, AddressingMode::Absolute, 4},
+    {0xCE, Operation::DEC, AddressingMode::Absolute, 6},
+    {0xCF, Operation::DCP, AddressingMode::Absolute, 6},
+    {0xD0, Operation::BNE, AddressingMode::Relative, 2},
+    {0xD1, Operation::CMP, AddressingMode::IndirectIndexed, 5},
+    {0xD3, Operation::DCP, AddressingMode::IndirectIndexed, 8},
+    {0xD4, Operation::NOP, AddressingMode::ZeroPageX, 4},
+    {0xD5, Operation::CMP, AddressingMode::ZeroPageX, 4},
+    {0xD6, Operation::DEC, AddressingMode::ZeroPageX, 6},
+    {0xD7, Operation::DCP, AddressingMode::ZeroPageX, 6},
+    {0xD8, Operation::CLD, AddressingMode::Implied, 2},
+    {0xD9, Operation::CMP, AddressingMode::AbsoluteY, 4},
+    {0xDB, Operation::DCP, AddressingMode::AbsoluteY, 7},
+    {0xDC, Operation::NOP, AddressingMode::AbsoluteX, 4},
+    {0xDD, Operation::CMP, AddressingMode::AbsoluteX, 4},
+    {0xDE, Operation::DEC, AddressingMode::AbsoluteX, 7},
+    {0xDF, Operation::DCP, AddressingMode::AbsoluteX, 7},
+    {0xE0, Operation::CPX, AddressingMode::Immediate, 2},
+    {0xE1, Operation::SBC, AddressingMode::IndexedIndirect, 6},
+    {0xE3, Operation::ISB, AddressingMode::IndexedIndirect, 8},
+    {0xE4, Operation::CPX, AddressingMode::ZeroPage, 3},
+    {0xE5, Operation::SBC, AddressingMode::ZeroPage, 3},
+    {0xE6, Operation::INC, AddressingMode::ZeroPage, 5},
+    {0xE7, Operation::ISB, AddressingMode::ZeroPage, 5},
+    {0xE8, Operation::INX, AddressingMode::Implied, 2},
+    {0xE9, Operation::SBC, AddressingMode::Immediate, 2},
+    {0xEB, Operation::SBC, AddressingMode::Immediate, 2},
+    {0xEC, Operation::CPX, AddressingMode::Absolute, 4},
+    {0xED, Operation::SBC, AddressingMode::Absolute, 4},
+    {0xEE, Operation::INC, AddressingMode::Absolute, 6},
+    {0xEF, Operation::ISB, AddressingMode::Absolute, 6},
+    {0xF0, Operation::BEQ, AddressingMode::Relative, 2},
+    {0xF1, Operation::SBC, AddressingMode::IndirectIndexed, 5},
+    {0xF3, Operation::ISB, AddressingMode::IndirectIndexed, 8},
+    {0xF4, Operation::NOP, AddressingMode::ZeroPageX, 4},
+    {0xF5, Operation::SBC, AddressingMode::ZeroPageX, 4},
+    {0xF6, Operation::INC, AddressingMode::ZeroPageX, 6},
+    {0xF7, Operation::ISB, AddressingMode::ZeroPageX, 6},
+    {0xF8, Operation::SED, AddressingMode::Implied, 2},
+    {0xF9, Operation::SBC, AddressingMode::AbsoluteY, 4},
+    {0xFB, Operation::ISB, AddressingMode::AbsoluteY, 7},
+    {0xFC, Operation::NOP, AddressingMode::AbsoluteX, 4},
+    {0xFD, Operation::SBC, AddressingMode::AbsoluteX, 4},
+    {0xFE, Operation::INC, AddressingMode::AbsoluteX, 7},
+    {0xFF, Operation::ISB, AddressingMode::AbsoluteX, 7},
+};
+
+// Opcodes that are not defined above execute as a single byte NOP
+constexpr std::array<OpcodeInfo, 256> makeOpcodeTable() {
+    std::array<OpcodeInfo, 256> table;
+    for(OpcodeInfo &info : table) {
+        info = { Operation::NOP, AddressingMode::Implied, 2 };
+    }
+    for(const OpcodeDefinition &definition : opcode_definitions) {
+        table[definition.opcode] = { definition.operation, definition.mode, definition.cycles };
+    }
+    return table;
+}
+
+static constexpr std::array<OpcodeInfo, 256> opcode_table = makeOpcodeTable();
+
+constexpr const char *mnemonic(Operation operation) {
+    return operation_mnemonics[static_cast<uint8_t>(operation)];
+}
+
+// Number of bytes an instruction occupies, including the opcode
+constexpr uint8_t instructionLength(AddressingMode mode) {
+    switch(mode) {
+        case AddressingMode::Implied:
+        case AddressingMode::Accumulator:
+            return 1;
+        case AddressingMode::Absolute:
+        case AddressingMode::AbsoluteX:
+        case AddressingMode::AbsoluteY:
+        case AddressingMode::Indirect:
+            return 3;
+        default:
+            return 2;
+    }
+}
+
+// Most cycles page crossing and taken branches can add to OpcodeInfo::cycles
+constexpr uint8_t penaltyCycles(AddressingMode mode) {
+    switch(mode) {
+        case AddressingMode::Relative:
+            return 2;
+        case AddressingMode::AbsoluteX:
+        case AddressingMode::AbsoluteY:
+        case AddressingMode::IndirectIndexed:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+#endif // CPU6502OPCODES_H_INCLUDED
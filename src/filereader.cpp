@@ -1,62 +1,139 @@
-#include <algorithm>
-#include <array>
 #include <cstring>
-#include <fstream>
-#include <vector>
 
 #include "filereader.h"
+#include "romimage.h"
 
 #include "mappers/mapper002.h"
 
-std::shared_ptr<Mapper> read_file(std::string filename) {
-    std::ifstream filestream(filename, std::ios_base::binary);
+// NES 2.0 sizes either count banks with 4 more bits from byte 9, or, when
+// those bits are all set, are given as 2^exponent * (multiplier*2+1)
+static bool romSize(uint8_t low, uint8_t high, uint32_t bank_size, uint64_t &size) {
+    if(high != 0xF) {
+        size = (uint64_t)((high << 8) | low) * bank_size;
+        return true;
+    }
+    uint8_t exponent = low >> 2;
+    if(exponent > 40) {
+        return false;
+    }
+    size = ((uint64_t)1 << exponent) * ((low & 3)*2 + 1);
+    return true;
+}
 
-    if(!filestream) {
-        std::cerr << "Error: Could not load the file " << filename << std::endl;
+bool ParseRomHeader(const uint8_t *data, size_t size, RomHeader &header) {
+    if(size < 16 || memcmp(data, "NES\x1a", 4) != 0) {
+        return false;
     }
 
-    std::vector<char> raw_rom(
-         (std::istreambuf_iterator<char>(filestream)),
-         (std::istreambuf_iterator<char>()));
+    uint8_t flags6 = data[6];
+    uint8_t flags7 = data[7];
 
-    filestream.close();
+    header = RomHeader();
+    header.nes2 = (flags7 & 0x0C) == 0x08;
+    header.mapper = (flags7 & 0xF0) | ((flags6 & 0xF0) >> 4);
+    header.battery = flags6 & (1 << 1);
+    header.trainer = flags6 & (1 << 2);
 
-    if(raw_rom.size() < 16) {
-        std::cerr << "iNES file is too small" << std::endl;
+    if( flags6 & (1 << 3) ) {
+        header.mirroring = Mirroring::FourScreen;
+    }
+    else if( flags6 & (1 << 0) ) {
+        header.mirroring = Mirroring::Vertical;
+    }
+    else {
+        header.mirroring = Mirroring::Horizontal;
     }
 
-    // Read constant header
-    std::string constant(raw_rom.begin(), raw_rom.begin()+4);
-    if(constant != "NES\x1a") {
-        std::cerr << "Error: File is not an iNES-file." << std::endl;
+    if(header.nes2) {
+        header.mapper |= (data[8] & 0x0F) << 8;
+        header.submapper = data[8] >> 4;
+        if( !romSize(data[4], data[9] & 0x0F, 0x4000, header.prg_rom_size) ||
+            !romSize(data[5], data[9] >> 4, 0x2000, header.chr_rom_size) ) {
+            return false;
+        }
+
+        // volatile and battery-backed RAM are counted together, each is
+        // given as a shift of 64 bytes
+        uint8_t prg_ram = data[10] & 0x0F, prg_nvram = data[10] >> 4;
+        uint8_t chr_ram = data[11] & 0x0F, chr_nvram = data[11] >> 4;
+        header.prg_ram_size = (prg_ram ? 64 << prg_ram : 0) + (prg_nvram ? 64 << prg_nvram : 0);
+        header.chr_ram_size = (chr_ram ? 64 << chr_ram : 0) + (chr_nvram ? 64 << chr_nvram : 0);
+    }
+    else {
+        header.prg_rom_size = data[4] * 0x4000;
+        header.chr_rom_size = data[5] * 0x2000;
+        header.prg_ram_size = (data[8] ? data[8] : 1) * 0x2000;
+        header.chr_ram_size = header.chr_rom_size == 0 ? 0x2000 : 0;
     }
+    return true;
+}
 
-    uint8_t num_prg_rom = raw_rom.at(4);
-    uint8_t num_chr_rom = raw_rom.at(5);
-    uint8_t flags6 = raw_rom.at(6);
-    uint8_t flags7 = raw_rom.at(7);
+// Why read_file() cannot load a ROM with this header, empty if it can.
+// The mappers index their banks from 0, so every ROM needs PRG ROM, and
+// NROM, which has no CHR RAM, needs CHR ROM too.
+static std::string unsupportedReason(const RomHeader &header) {
+    if(header.mapper != 0 && header.mapper != 2) {
+        return "Mapper " + std::to_string(header.mapper) + " is not supported.";
+    }
+    if(header.prg_rom_size == 0) {
+        return "iNES file has no PRG ROM";
+    }
+    if(header.mapper == 0 && header.chr_rom_size == 0) {
+        return "NROM file has no CHR ROM";
+    }
+    if(header.prg_rom_size % 0x4000 != 0 || header.chr_rom_size % 0x2000 != 0) {
+        return "iNES file has partial ROM banks";
+    }
+    return "";
+}
+
+bool IsMapperSupported(const RomHeader &header) {
+    return unsupportedReason(header).empty();
+}
+
+std::shared_ptr<Mapper> read_file(std::string filename) {
+    std::shared_ptr<const RomImage> image = RomImage::Open(filename);
+    if(!image) {
+        return NULL;
+    }
+    const uint8_t *raw_rom = image->Data();
 
-    uint8_t mapper_id = ( (flags7 & 0xF0) | ((flags6 & 0xF0) >> 4));
+    RomHeader header;
+    if(image->Size() < 16) {
+        std::cerr << "Error: iNES file is too small" << std::endl;
+        return NULL;
+    }
+    if(!ParseRomHeader(raw_rom, image->Size(), header)) {
+        std::cerr << "Error: File is not an iNES-file." << std::endl;
+        return NULL;
+    }
+    if(!IsMapperSupported(header)) {
+        std::cerr << "Error: " << unsupportedReason(header) << std::endl;
+        return NULL;
+    }
 
     std::shared_ptr<Mapper> mapper;
-    switch(mapper_id) {
+    switch(header.mapper) {
         case 0: mapper = std::make_shared<Mapper>(); break;
         case 2: mapper = std::make_shared<Mapper002>(); break;
     }
+    mapper->SetMirroring(header.mirroring);
 
-    size_t prg_rom_offset = 0x10;
-    for(size_t i=0; i<num_prg_rom; ++i) {
-        std::array<uint8_t, 0x4000> prg_rom;
-        std::copy_n(raw_rom.begin()+prg_rom_offset+0x4000*i, 0x4000, prg_rom.begin());
-        mapper->AddPrgRomBank(prg_rom);
+    if(image->Size() < header.RomEnd()) {
+        std::cerr << "Error: iNES file is missing ROM banks" << std::endl;
+        return NULL;
     }
 
-    size_t chr_rom_offset = prg_rom_offset+0x4000*num_prg_rom;
-    for(size_t i=0; i<num_chr_rom; ++i) {
-        std::array<uint8_t, 0x2000> chr_rom;
-        std::copy_n(raw_rom.begin()+chr_rom_offset+0x2000*i, 0x2000, chr_rom.begin());
-        mapper->AddChrRomBank(chr_rom);
+    // The banks are not copied, they point into the image
+    size_t prg_rom_offset = header.PrgRomOffset();
+    size_t chr_rom_offset = prg_rom_offset + header.prg_rom_size;
+    mapper->SetRomImage(image);
+    for(size_t i=0; i<header.prg_rom_size/0x4000; ++i) {
+        mapper->AddPrgRomBank(PrgRomBank(raw_rom+prg_rom_offset+0x4000*i, 0x4000));
+    }
+    for(size_t i=0; i<header.chr_rom_size/0x2000; ++i) {
+        mapper->AddChrRomBank(ChrRomBank(raw_rom+chr_rom_offset+0x2000*i, 0x2000));
     }
 
     return mapper;
-}
\ No newline at end of file
+}
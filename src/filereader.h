@@ -1,11 +1,39 @@
 #ifndef FILEREADER_H_INCLUDED
 #define FILEREADER_H_INCLUDED
 
+#include <stddef.h>
+#include <stdint.h>
 #include <string>
 #include <memory>
 
 #include "mappers/mapper.h"
 
+// The fields of an iNES or NES 2.0 header. Sizes are in bytes.
+struct RomHeader {
+    bool nes2 = false;
+    uint16_t mapper = 0;
+    uint8_t submapper = 0;
+    Mirroring mirroring = Mirroring::Horizontal;
+    bool battery = false;
+    bool trainer = false;
+    uint64_t prg_rom_size = 0;
+    uint64_t chr_rom_size = 0;
+    uint32_t prg_ram_size = 0;
+    uint32_t chr_ram_size = 0;
+
+    // Where PRG ROM starts in the file, CHR ROM follows it
+    size_t PrgRomOffset() const { return 16 + (trainer ? 512 : 0); }
+    size_t RomEnd() const { return PrgRomOffset() + prg_rom_size + chr_rom_size; }
+};
+
+// Returns false if data does not start with an iNES header
+bool ParseRomHeader(const uint8_t *data, size_t size, RomHeader &header);
+
+// Whether read_file() has a mapper for the ROM
+bool IsMapperSupported(const RomHeader &header);
+
+// Returns NULL if the file is not a complete iNES file using a supported
+// mapper
 std::shared_ptr<Mapper> read_file(std::string filename);
 
 #endif // FILEREADER_H_INCLUDED
@@ -0,0 +1,178 @@
+#include <string.h>
+#include <algorithm>
+
+#include "hash.h"
+
+/******************
+* CRC-32
+******************/
+
+// Slicing-by-4: table[k][b] is the CRC of byte b followed by k zero bytes,
+// so four bytes are folded in per step instead of one
+static std::array<std::array<uint32_t, 256>, 4> makeCrcTables() {
+    std::array<std::array<uint32_t, 256>, 4> tables;
+    for(uint32_t i=0; i<256; ++i) {
+        uint32_t crc = i;
+        for(int bit=0; bit<8; ++bit) {
+            crc = (crc >> 1) ^ (crc & 1 ? 0xEDB88320 : 0);
+        }
+        tables[0][i] = crc;
+    }
+    for(uint32_t i=0; i<256; ++i) {
+        for(int k=1; k<4; ++k) {
+            tables[k][i] = (tables[k-1][i] >> 8) ^ tables[0][tables[k-1][i] & 0xFF];
+        }
+    }
+    return tables;
+}
+
+uint32_t Crc32(const uint8_t *data, size_t size, uint32_t crc) {
+    static const std::array<std::array<uint32_t, 256>, 4> tables = makeCrcTables();
+
+    crc = ~crc;
+    for(; size >= 4; size -= 4, data += 4) {
+        crc ^= data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+        crc = tables[3][crc & 0xFF] ^ tables[2][(crc >> 8) & 0xFF] ^
+              tables[1][(crc >> 16) & 0xFF] ^ tables[0][crc >> 24];
+    }
+    for(; size > 0; --size, ++data) {
+        crc = (crc >> 8) ^ tables[0][(crc ^ *data) & 0xFF];
+    }
+    return ~crc;
+}
+
+/******************
+* SHA-1
+******************/
+
+static uint32_t rotateLeft(uint32_t value, int bits) {
+    return (value << bits) | (value >> (32-bits));
+}
+
+Sha1::Sha1() {
+    state[0] = 0x67452301;
+    state[1] = 0xEFCDAB89;
+    state[2] = 0x98BADCFE;
+    state[3] = 0x10325476;
+    state[4] = 0xC3D2E1F0;
+}
+
+void Sha1::Transform(const uint8_t *block) {
+    uint32_t w[80];
+    for(int i=0; i<16; ++i) {
+        w[i] = ((uint32_t)block[4*i] << 24) | (block[4*i+1] << 16) | (block[4*i+2] << 8) | block[4*i+3];
+    }
+    for(int i=16; i<80; ++i) {
+        w[i] = rotateLeft(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+    for(int i=0; i<80; ++i) {
+        uint32_t f, k;
+        if(i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        }
+        else if(i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        }
+        else if(i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        }
+        else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+        uint32_t temp = rotateLeft(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rotateLeft(b, 30);
+        b = a;
+        a = temp;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+void Sha1::Update(const uint8_t *data, size_t size) {
+    length += size;
+
+    if(block_size > 0) {
+        size_t count = std::min(size, sizeof(block) - block_size);
+        memcpy(block + block_size, data, count);
+        block_size += count;
+        data += count;
+        size -= count;
+        if(block_size < sizeof(block)) {
+            return;
+        }
+        Transform(block);
+        block_size = 0;
+    }
+
+    // whole blocks are hashed straight from the input
+    for(; size >= sizeof(block); size -= sizeof(block), data += sizeof(block)) {
+        Transform(data);
+    }
+    memcpy(block, data, size);
+    block_size = size;
+}
+
+Sha1Digest Sha1::Final() {
+    uint64_t bits = length * 8;
+
+    uint8_t padding[72] = { 0x80 };
+    size_t padding_size = (block_size < 56 ? 56 : 120) - block_size;
+    for(int i=0; i<8; ++i) {
+        padding[padding_size+i] = bits >> (56 - 8*i);
+    }
+    Update(padding, padding_size + 8);
+
+    Sha1Digest digest;
+    for(int i=0; i<20; ++i) {
+        digest[i] = state[i/4] >> (24 - 8*(i%4));
+    }
+    return digest;
+}
+
+/******************
+* hex
+******************/
+
+std::string ToHex(const uint8_t *data, size_t size) {
+    static const char digits[] = "0123456789abcdef";
+    std::string text(2*size, '0');
+    for(size_t i=0; i<size; ++i) {
+        text[2*i] = digits[data[i] >> 4];
+        text[2*i+1] = digits[data[i] & 0xF];
+    }
+    return text;
+}
+
+static int hexValue(char digit) {
+    if(digit >= '0' && digit <= '9') return digit - '0';
+    if(digit >= 'a' && digit <= 'f') return digit - 'a' + 10;
+    if(digit >= 'A' && digit <= 'F') return digit - 'A' + 10;
+    return -1;
+}
+
+bool ParseHex(const std::string &text, uint8_t *data, size_t size) {
+    if(text.size() != 2*size) {
+        return false;
+    }
+    for(size_t i=0; i<size; ++i) {
+        int high = hexValue(text[2*i]);
+        int low = hexValue(text[2*i+1]);
+        if(high < 0 || low < 0) {
+            return false;
+        }
+        data[i] = (high << 4) | low;
+    }
+    return true;
+}
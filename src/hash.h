@@ -0,0 +1,38 @@
+#ifndef HASH_H_INCLUDED
+#define HASH_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <array>
+#include <string>
+
+// CRC-32 as used by zip and the ROM databases. Pass the previous result as
+// crc to continue over more data.
+uint32_t Crc32(const uint8_t *data, size_t size, uint32_t crc = 0);
+
+typedef std::array<uint8_t, 20> Sha1Digest;
+
+class Sha1 {
+    public:
+        Sha1();
+
+        void Update(const uint8_t *data, size_t size);
+
+        // Only valid once, after the last Update()
+        Sha1Digest Final();
+
+    private:
+        uint32_t state[5];
+        uint8_t block[64];
+        size_t block_size = 0;
+        uint64_t length = 0;
+
+        void Transform(const uint8_t *block);
+};
+
+// Lowercase hex, and back. ParseHex() fails unless text is exactly
+// 2*size hex digits.
+std::string ToHex(const uint8_t *data, size_t size);
+bool ParseHex(const std::string &text, uint8_t *data, size_t size);
+
+#endif // HASH_H_INCLUDED
@@ -12,7 +12,7 @@ uint8_t Mapper::ReadPrg(const uint16_t &address) {
             idx -= 0x4000;
         }
 
-        uint8_t retVal = prg_rom_banks.at(rom_bank).at(idx);
+        uint8_t retVal = prg_rom_banks.at(rom_bank)[idx];
         return retVal;
     }
     else {
@@ -20,18 +20,41 @@ uint8_t Mapper::ReadPrg(const uint16_t &address) {
     }
 }
 
+const uint8_t *Mapper::GetPrgPage(const uint16_t &address) {
+    if(address < 0x8000) {
+        return NULL;
+    }
+    uint8_t rom_bank = 0;
+    if(address >= 0xc000 && prg_rom_banks.size() == 2) {
+        rom_bank = 1;
+    }
+    return prg_rom_banks.at(rom_bank).data() + ((address - 0x8000) & 0x3F00);
+}
+
 uint8_t Mapper::ReadChr(const uint16_t &address) {
-    return chr_rom_banks.at(0).at(address);
+    return chr_rom_banks.at(0)[address & 0x1FFF];
+}
+
+const uint8_t *Mapper::GetChrRom() {
+    return chr_rom_banks.empty() ? NULL : chr_rom_banks[0].data();
 }
 
-void Mapper::AddPrgRomBank(std::array<uint8_t, 0x4000> prg_bank) {
+void Mapper::AddPrgRomBank(PrgRomBank prg_bank) {
     this->prg_rom_banks.push_back(prg_bank);
 }
 
-void Mapper::AddChrRomBank(std::array<uint8_t, 0x2000> chr_bank) {
+void Mapper::AddChrRomBank(ChrRomBank chr_bank) {
     this->chr_rom_banks.push_back(chr_bank);
 }
 
+void Mapper::SaveState(StateWriter &state) {
+    state.Write(fake_ram);
+}
+
+void Mapper::LoadState(StateReader &state) {
+    state.Read(fake_ram);
+}
+
 std::ostream& operator<<(std::ostream& stream, const Mapper& mapper)
 {
     stream << mapper.mapper_id << " PRGROM: " << mapper.prg_rom_banks.size() << " CHRROM: " << mapper.chr_rom_banks.size() << std::endl;
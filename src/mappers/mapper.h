@@ -5,6 +5,26 @@
 #include <vector>
 #include <array>
 #include <cstdint>
+#include <memory>
+#include <span>
+
+#include "savestate.h"
+#include "romimage.h"
+
+// ROM banks point into the RomImage the mapper was loaded from
+typedef std::span<const uint8_t, 0x4000> PrgRomBank;
+typedef std::span<const uint8_t, 0x2000> ChrRomBank;
+
+// How the four 1 KB nametables at $2000-$2FFF are backed by nametable RAM.
+// Horizontal mirroring pairs $2000 with $2400 and $2800 with $2C00,
+// vertical mirroring pairs $2000 with $2800 and $2400 with $2C00.
+enum class Mirroring {
+    Horizontal,
+    Vertical,
+    SingleScreenLow,
+    SingleScreenHigh,
+    FourScreen
+};
 
 class Mapper {
     public:
@@ -14,18 +34,50 @@ class Mapper {
         virtual uint8_t ReadChr(const uint16_t &address);
         virtual void WriteChr(const uint16_t &address, const uint8_t &value) {};
 
-        virtual void AddPrgRomBank(std::array<uint8_t, 0x4000> prg_bank);
-        virtual void AddChrRomBank(std::array<uint8_t, 0x2000> chr_bank);
+        // Changes whenever ReadChr() may return something else for an
+        // address, other than through WriteChr()
+        uint32_t GetChrVersion() const { return chr_version; }
+
+        // The 8 KB CHR ROM bank the PPU sees, or NULL if it sees CHR RAM.
+        // GetChrVersion() changes whenever the bank changes.
+        virtual const uint8_t *GetChrRom();
 
-        std::array<uint8_t, 0x10000> fake_ram;
+        // Returns the 256 byte page of PRG memory containing address, or
+        // NULL if reads from it can not be served directly from memory.
+        // GetPrgVersion() changes whenever the returned pages change.
+        virtual const uint8_t *GetPrgPage(const uint16_t &address);
+        uint32_t GetPrgVersion() const { return prg_version; }
+
+        // The banks have to lie within the image, which the mapper keeps
+        // alive for as long as it exists
+        void SetRomImage(std::shared_ptr<const RomImage> rom_image) { this->rom_image = rom_image; }
+        virtual void AddPrgRomBank(PrgRomBank prg_bank);
+        virtual void AddChrRomBank(ChrRomBank chr_bank);
+
+        // Bank registers and RAM, the ROM banks are not part of the state
+        virtual void SaveState(StateWriter &state);
+        virtual void LoadState(StateReader &state);
+        const std::string &GetId() const { return mapper_id; }
+
+        // Set from the iNES header, mappers that switch mirroring change
+        // it while running
+        Mirroring GetMirroring() const { return mirroring; }
+        void SetMirroring(Mirroring mirroring) { this->mirroring = mirroring; }
+
+        std::array<uint8_t, 0x10000> fake_ram = {};
 
         friend std::ostream& operator<<(std::ostream& os, const Mapper& mapper);
 
     protected:
-        std::vector< std::array<uint8_t, 0x4000> > prg_rom_banks;
-        std::vector< std::array<uint8_t, 0x2000> > chr_rom_banks;
+        std::shared_ptr<const RomImage> rom_image;
+        std::vector<PrgRomBank> prg_rom_banks;
+        std::vector<ChrRomBank> chr_rom_banks;
 
         std::string mapper_id = "Mapper 000 (NROM)";
+
+        uint32_t prg_version = 0;
+        uint32_t chr_version = 0;
+        Mirroring mirroring = Mirroring::Horizontal;
 };
 
 #endif // MAPPER_H_INCLUDED
\ No newline at end of file
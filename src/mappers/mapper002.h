@@ -16,17 +16,33 @@ class Mapper002 : public Mapper {
 
         if(0x8000 <= address && address <= 0xBFFF) {
             uint16_t idx = address - 0x8000;
-            uint8_t retVal = prg_rom_banks.at(current_bank).at(idx);
+            uint8_t retVal = prg_rom_banks.at(current_bank)[idx];
             return retVal;
         }
         uint16_t idx = address-0xC000;
-        uint8_t retval = prg_rom_banks.at(prg_rom_banks.size()-1).at(idx);
+        uint8_t retval = prg_rom_banks.at(prg_rom_banks.size()-1)[idx];
         return retval;
     };
 
+    const uint8_t *GetPrgPage(const uint16_t &address) {
+        if(address < 0x8000) {
+            return NULL;
+        }
+
+        if(address <= 0xBFFF) {
+            // switching to a bank that does not exist is left to ReadPrg()
+            if(current_bank >= prg_rom_banks.size()) {
+                return NULL;
+            }
+            return prg_rom_banks[current_bank].data() + (address & 0x3F00);
+        }
+        return prg_rom_banks.at(prg_rom_banks.size()-1).data() + (address & 0x3F00);
+    };
+
     void WritePrg(const uint16_t &address, const uint8_t &value) {
-        if(address >= 0x8000) {
+        if(address >= 0x8000 && current_bank != (value&0x7)) {
             current_bank = value&0x7;
+            prg_version += 1;
         }
     };
 
@@ -38,7 +54,25 @@ class Mapper002 : public Mapper {
         chr_ram[address % 0x2000] = value;
     }
 
+    const uint8_t *GetChrRom() {
+        return NULL;
+    }
+
+    void SaveState(StateWriter &state) {
+        Mapper::SaveState(state);
+        state.Write(current_bank);
+        state.Write(chr_ram);
+    }
+
+    void LoadState(StateReader &state) {
+        Mapper::LoadState(state);
+        state.Read(current_bank);
+        state.Read(chr_ram);
+        prg_version += 1;
+        chr_version += 1;
+    }
+
     private:
         uint8_t current_bank = 0;
-        std::array<uint8_t, 0x2000> chr_ram;
+        std::array<uint8_t, 0x2000> chr_ram = {};
 };
\ No newline at end of file
@@ -0,0 +1,177 @@
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+#include "movie.h"
+#include "savestate.h"
+
+// Layout of a movie file, integers little-endian as in save states:
+//   "NESLIGMV"            8 bytes
+//   version               uint32
+//   ROM SHA-1             20 bytes
+//   ports                 uint8
+//   frame count           uint32
+//   input                 one byte per port per frame
+static const char movie_magic[8] = {'N', 'E', 'S', 'L', 'I', 'G', 'M', 'V'};
+static const uint32_t movie_version = 1;
+
+void Movie::Record(Console &console) {
+    for(int port=0; port<ports; ++port) {
+        input.push_back( getButtons(&console.GetController(port)) );
+    }
+}
+
+bool Movie::Apply(size_t frame, Console &console) const {
+    bool in_movie = frame < Size();
+    for(int port=0; port<ports; ++port) {
+        setButtons(&console.GetController(port), in_movie ? GetButtons(frame, port) : 0);
+    }
+    return in_movie;
+}
+
+void Movie::Truncate(size_t frames) {
+    if(frames < Size()) {
+        input.resize(frames*ports);
+    }
+}
+
+bool Movie::Save(const std::string &filename) const {
+    std::vector<uint8_t> data;
+    StateWriter movie(data);
+    movie.Write((const uint8_t*)movie_magic, sizeof(movie_magic));
+    movie.Write(movie_version);
+    movie.Write(rom_sha1);
+    movie.Write((uint8_t)ports);
+    movie.Write((uint32_t)Size());
+    movie.Write(input.data(), input.size());
+
+    std::ofstream out(filename, std::ios_base::binary);
+    out.write((const char*)data.data(), data.size());
+    if(!out) {
+        std::cerr << "Error: Could not write the movie " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Movie::Load(const std::string &filename) {
+    std::ifstream in(filename, std::ios_base::binary);
+    if(!in) {
+        std::cerr << "Error: Could not load the movie " << filename << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> data(
+         (std::istreambuf_iterator<char>(in)),
+         (std::istreambuf_iterator<char>()));
+
+    StateReader movie(data.data(), data.size());
+    char magic[sizeof(movie_magic)];
+    uint32_t version = 0;
+    movie.Read((uint8_t*)magic, sizeof(magic));
+    movie.Read(version);
+    if(movie.Failed() || memcmp(magic, movie_magic, sizeof(magic)) != 0 || version != movie_version) {
+        std::cerr << "Error: " << filename << " is not a movie of version " << movie_version << std::endl;
+        return false;
+    }
+
+    Sha1Digest sha1;
+    uint8_t port_count = 0;
+    uint32_t frames = 0;
+    movie.Read(sha1);
+    movie.Read(port_count);
+    movie.Read(frames);
+    if(movie.Failed() || port_count != ports || movie.Remaining() != (size_t)frames*ports) {
+        std::cerr << "Error: The movie " << filename << " is truncated" << std::endl;
+        return false;
+    }
+
+    rom_sha1 = sha1;
+    input.resize((size_t)frames*ports);
+    movie.Read(input.data(), input.size());
+    return true;
+}
+
+// An FM2 file is a text header of "key value" lines, followed by one line
+// per frame: "|commands|port 0|port 1|port 2|". A gamepad is 8 characters
+// for Right, Left, Down, Up, Start, Select, B and A, where '.' or ' ' is a
+// released button.
+bool Movie::ImportFm2(const std::string &filename) {
+    std::ifstream in(filename);
+    if(!in) {
+        std::cerr << "Error: Could not load the movie " << filename << std::endl;
+        return false;
+    }
+
+    std::vector<uint8_t> imported;
+    bool ignored_commands = false;
+    std::string line;
+    while(std::getline(in, line)) {
+        if(!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+
+        if(line.empty() || line[0] != '|') {
+            std::istringstream header(line);
+            std::string key, value;
+            header >> key >> value;
+            if( (key == "binary" && value != "0") || (key == "savestate" && !value.empty()) ||
+                ((key == "port0" || key == "port1") && value != "0" && value != "1") || (key == "fourscore" && value != "0") ) {
+                std::cerr << "Error: " << filename << " uses " << key << " " << value << ", which is not supported" << std::endl;
+                return false;
+            }
+            continue;
+        }
+
+        // fields[0] is empty, then come the commands and the ports
+        std::vector<std::string> fields;
+        std::istringstream frame(line);
+        std::string field;
+        while(std::getline(frame, field, '|')) {
+            fields.push_back(field);
+        }
+        if(fields.size() < 2) {
+            std::cerr << "Error: Malformed input in " << filename << ": " << line << std::endl;
+            return false;
+        }
+
+        // a power-on command on the first frame is where the movie starts
+        // anyway
+        int commands = atoi(fields[1].c_str());
+        if(commands != 0 && !(commands == 2 && imported.empty())) {
+            ignored_commands = true;
+        }
+
+        for(int port=0; port<ports; ++port) {
+            uint8_t buttons = 0;
+            if((size_t)port+2 < fields.size()) {
+                const std::string &pad = fields[port+2];
+                for(size_t i=0; i<8 && i<pad.size(); ++i) {
+                    if(pad[i] != '.' && pad[i] != ' ') {
+                        buttons |= 1 << (7-i);
+                    }
+                }
+            }
+            imported.push_back(buttons);
+        }
+    }
+
+    if(ignored_commands) {
+        std::cerr << "Warning: " << filename << " resets the console, which is ignored" << std::endl;
+    }
+    rom_sha1 = {};
+    input = std::move(imported);
+    return true;
+}
+
+bool Movie::LoadAny(const std::string &filename) {
+    std::string extension = filename.size() >= 4 ? filename.substr(filename.size()-4) : "";
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if(extension == ".fm2") {
+        return ImportFm2(filename);
+    }
+    return Load(filename);
+}
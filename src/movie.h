@@ -0,0 +1,52 @@
+#ifndef MOVIE_H_INCLUDED
+#define MOVIE_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "console.h"
+#include "hash.h"
+
+// Controller input for every frame from power-on, so a run can be repeated
+// exactly without anyone at the keyboard. Each frame holds one byte per
+// controller port, laid out like getButtons().
+class Movie {
+    public:
+        static const int ports = 2;
+
+        // Appends the buttons currently held on the console's controllers
+        // as the input of the next frame
+        void Record(Console &console);
+
+        // Holds the buttons of frame on the console's controllers. Frames
+        // past the end release every button and return false.
+        bool Apply(size_t frame, Console &console) const;
+
+        // Drops every frame from frames on
+        void Truncate(size_t frames);
+
+        size_t Size() const { return input.size() / ports; }
+        uint8_t GetButtons(size_t frame, int port) const { return input.at(frame*ports + port); }
+
+        bool Save(const std::string &filename) const;
+        bool Load(const std::string &filename);
+
+        // Reads a text FCEUX movie. Only gamepads are supported, and the
+        // movie has to start from power-on. Resets are ignored.
+        bool ImportFm2(const std::string &filename);
+
+        // Loads filename with ImportFm2() if it ends in .fm2, else Load()
+        bool LoadAny(const std::string &filename);
+
+        // SHA-1 of the PRG and CHR ROM the movie was recorded with, as
+        // computed by ReadRomEntry(). All zeros if unknown, such as for
+        // imported movies.
+        Sha1Digest rom_sha1 = {};
+
+    private:
+        std::vector<uint8_t> input;
+};
+
+#endif // MOVIE_H_INCLUDED
@@ -1,9 +1,10 @@
 #include <assert.h>
+#include <algorithm>
 #include "ppu2C02.h"
 #include "cpu6502.h"
 
-PPU2C02state::PPU2C02state(SDL_Surface *screenSurface) {
-    this->screenSurface = screenSurface;
+PPU2C02state::PPU2C02state(FrameBuffer frame_buffer) {
+    this->frame_buffer = frame_buffer;
     scanline = 241;
     dot = 0;
     odd_frame = 0;
@@ -11,10 +12,15 @@ PPU2C02state::PPU2C02state(SDL_Surface *screenSurface) {
     nmi_output = 0;
 
     oam.fill(0xff);
+    nametable_ram.fill(0);
+    palette_ram.fill(0);
+    updatePalette();
 }
 
 void PPU2C02state::SetMapper(std::shared_ptr<Mapper> mapper) {
     this->mapper = mapper;
+    tile_cache.SetMapper(mapper);
+    updateMirroring();
 }
 
 void PPU2C02state::PPUcycle() {
@@ -42,7 +48,7 @@ void PPU2C02state::PPUcycle() {
 
         //visible cycles
         if( dot < 256 ) {
-            renderPixel(screenSurface);
+            renderPixel();
         }
     }
 
@@ -63,6 +69,7 @@ void PPU2C02state::PPUcycle() {
 
         if(dot == 2) {
             sprite_zero_hit = 0;
+            sprite_overflow = 0;
             nmi_occurred = 0;
         }
 
@@ -74,6 +81,72 @@ void PPU2C02state::PPUcycle() {
     }
 }
 
+void PPU2C02state::RunCycles(uint32_t cycles) {
+    while(cycles > 0) {
+        //the CPU is past the whole next line, so no register was written
+        //while it was drawn and it can be rendered in one go
+        if( cycles >= 341 && CanRenderScanline() ) {
+            renderScanline();
+            cycles -= 341;
+            continue;
+        }
+
+        uint32_t idle = std::min(IdleCycles(), cycles);
+        if(idle > 0) {
+            uint32_t position = scanline*341 + dot + idle;
+            scanline = position / 341;
+            dot = position % 341;
+            cycles -= idle;
+        }
+        else {
+            PPUcycle();
+            cycles -= 1;
+        }
+    }
+}
+
+bool PPU2C02state::CanRenderScanline() {
+    if( dot != 340 || !(scanline < 239 || scanline == 261) ) {
+        return false;
+    }
+    //odd frames skip the first dot of scanline 0
+    if( scanline == 261 && odd_frame == 1 ) {
+        return false;
+    }
+    return rendering_enabled() && !(nmi_output && nmi_occurred);
+}
+
+//number of upcoming cycles in which PPUcycle() would only advance the dot counter
+uint32_t PPU2C02state::IdleCycles() {
+    if( (nmi_output && nmi_occurred) || scanline == 261 ) {
+        return 0;
+    }
+    if( scanline < 240 && rendering_enabled() ) {
+        return 0;
+    }
+
+    uint32_t position = scanline*341 + dot;
+    uint32_t next_event = 261*341;
+    if( position < 241*341 + 1 ) {
+        next_event = 241*341 + 1;
+    }
+    return next_event - position - 1;
+}
+
+//number of cycles until the PPU raises an NMI or starts a new frame
+uint32_t PPU2C02state::CyclesUntilEvent() {
+    if( nmi_output && nmi_occurred ) {
+        return 1;
+    }
+
+    int32_t distance = (241*341 + 1) - (scanline*341 + dot);
+    if( distance <= 0 ) {
+        distance += 262*341;
+    }
+    //the skipped dot on odd frames can make the event come one cycle early
+    return distance > 1 ? distance-1 : 1;
+}
+
 uint8_t PPU2C02state::rendering_enabled() {
     return ppumask & ((1<<3)|(1<<4));
 }
@@ -120,10 +193,10 @@ void PPU2C02state::handleVisibleScanline() {
                 fetchAttribute();
                 break;
             case 5:
-                bitmap_shift_0_latch = readVRAM(pattern_base + pattern_index*16+row);
+                bitmap_shift_0_latch = tile_cache.GetPattern(pattern_base + pattern_index*16+row);
                 break;
             case 7:
-                bitmap_shift_1_latch = readVRAM(pattern_base + pattern_index*16+row+8);
+                bitmap_shift_1_latch = tile_cache.GetPattern(pattern_base + pattern_index*16+row+8);
                 break;
         }
 
@@ -179,10 +252,10 @@ uint8_t PPU2C02state::readRegisters(uint16_t address) {
     //PPUSTATUS
     if(address == 0x2002) {
         w = 0;
-        retVal = ((sprite_zero_hit << 6) | (nmi_occurred << 7));
+        retVal = ((sprite_overflow << 5) | (sprite_zero_hit << 6) | (nmi_occurred << 7));
         nmi_occurred = 0;
         if(scanline == 241 && dot == 1) {
-            retVal = (sprite_zero_hit << 6);
+            retVal = ((sprite_overflow << 5) | (sprite_zero_hit << 6));
         }
     }
 
@@ -231,7 +304,7 @@ uint8_t PPU2C02state::writeRegisters(uint16_t address, uint8_t value) {
 
     //OAMDATA
     else if(address == 0x2004) {
-        this->oam[this->OAM_address++] = value;
+        writeSPRRAM(this->OAM_address++, value);
     }
 
     //PPUSCROLL
@@ -282,38 +355,176 @@ uint8_t PPU2C02state::writeRegisters(uint16_t address, uint8_t value) {
     return 0;
 }
 
+//palette entries $3F10, $3F14, $3F18 and $3F1C mirror the backdrop
+//entries below them
+static uint8_t paletteIndex(uint16_t address) {
+    address &= 0x1F;
+    if( (address & 0x13) == 0x10 ) {
+        address &= ~0x10;
+    }
+    return address;
+}
+
 void PPU2C02state::writeVRAM(uint16_t address, uint8_t value) {
+    address &= 0x3FFF;
     if(address <= 0x1FFF) {
         mapper->WriteChr(address, value);
-        return;
+        tile_cache.Invalidate(address);
     }
-    assert(address <= 0x3F20);
-    vram[address] = value;
-    if( address == 0x3F10 || address == 0x3F14 || address == 0x3F18 || address == 0x3F1C ) {
-        address -= 0x10;
+    else if(address <= 0x3EFF) {
+        nametableByte(address) = value;
+    }
+    else {
+        palette_ram[paletteIndex(address)] = value;
+        updatePalette();
     }
-    address &= 0x3FFF;
-    vram[address] = value;
 }
 
-uint8_t PPU2C02state::readVRAM(uint16_t address) {
-    assert(address <= 0x3F20);
-    if( address == 0x3F10 || address == 0x3F14 || address == 0x3F18 || address == 0x3F1C ) {
-        address -= 0x10;
+void PPU2C02state::updatePalette() {
+    for(int entry=0; entry<32; ++entry) {
+        palette_indices[entry] = palette_ram[paletteIndex(entry)] & 0x3F;
     }
-    address &= 0x3FFF;
-    switch(address) {
-        case 0x0000 ... 0x1FFF:
-            return mapper->ReadChr(address);
-        default:
-            return vram[address];
+}
+
+void PPU2C02state::updateMirroring() {
+    static const uint8_t pages[5][4] = {
+        {0, 0, 1, 1}, //horizontal
+        {0, 1, 0, 1}, //vertical
+        {0, 0, 0, 0}, //single screen, low
+        {1, 1, 1, 1}, //single screen, high
+        {0, 1, 2, 3}, //four screen
+    };
+
+    mirroring = mapper->GetMirroring();
+    for(int i=0; i<4; ++i) {
+        nametables[i] = nametable_ram.data() + 0x400*pages[(int)mirroring][i];
     }
+}
 
+uint8_t PPU2C02state::readVRAM(uint16_t address) {
+    address &= 0x3FFF;
+    if(address <= 0x1FFF) {
+        return mapper->ReadChr(address);
+    }
+    else if(address <= 0x3EFF) {
+        return nametableByte(address);
+    }
+    return palette_ram[paletteIndex(address)];
 }
 
 void PPU2C02state::writeSPRRAM(uint8_t address, uint8_t value) {
+    if( (address & 3) == 0 && this->oam[address] != value ) {
+        sprite_index_dirty = true;
+    }
     this->oam[address] = value;
 }
 uint8_t PPU2C02state::readSPRRAM(uint8_t address) {
     return this->oam[address];
-}
\ No newline at end of file
+}
+
+void PPU2C02state::SaveState(StateWriter &state) {
+    state.Write(nametable_ram);
+    state.Write(palette_ram);
+    state.Write(oam);
+
+    state.Write(VRAM_address);
+    state.Write(OAM_address);
+    state.Write(internal_buffer);
+    state.Write(w);
+    state.Write(t);
+    state.Write(x);
+    state.Write(y);
+    state.Write(ppuctrl);
+    state.Write(ppumask);
+    state.Write(ppustatus);
+    state.Write(oamaddr);
+    state.Write(oamdata);
+    state.Write(ppuscroll);
+    state.Write(ppuaddr);
+    state.Write(ppudata);
+    state.Write(oamdma);
+    state.Write(nmi);
+    state.Write(odd_frame);
+    state.Write(scanline);
+    state.Write(dot);
+    state.Write(nmi_occurred);
+    state.Write(nmi_output);
+    state.Write(sprite_zero_hit);
+    state.Write(sprite_overflow);
+    state.Write(nametable_base);
+    state.Write(bitmap_shift_0_latch);
+    state.Write(bitmap_shift_1_latch);
+    state.Write(bitmap_shift_0);
+    state.Write(bitmap_shift_1);
+    state.Write(AT_shift_0_latch);
+    state.Write(AT_shift_1_latch);
+    state.Write(AT_shift_0);
+    state.Write(AT_shift_1);
+    state.Write(num_sprites);
+    state.Write(current_frame);
+
+    for(PPUsprite &sprite : sprites) {
+        state.Write(sprite.sprite_index);
+        state.Write(sprite.byte2);
+        state.Write(sprite.pattern_0);
+        state.Write(sprite.pattern_1);
+        state.Write(sprite.attribute);
+        state.Write(sprite.x);
+    }
+    state.Write(sprite_scanline);
+}
+
+void PPU2C02state::LoadState(StateReader &state) {
+    state.Read(nametable_ram);
+    state.Read(palette_ram);
+    updatePalette();
+    state.Read(oam);
+    sprite_index_dirty = true;
+
+    state.Read(VRAM_address);
+    state.Read(OAM_address);
+    state.Read(internal_buffer);
+    state.Read(w);
+    state.Read(t);
+    state.Read(x);
+    state.Read(y);
+    state.Read(ppuctrl);
+    state.Read(ppumask);
+    state.Read(ppustatus);
+    state.Read(oamaddr);
+    state.Read(oamdata);
+    state.Read(ppuscroll);
+    state.Read(ppuaddr);
+    state.Read(ppudata);
+    state.Read(oamdma);
+    state.Read(nmi);
+    state.Read(odd_frame);
+    state.Read(scanline);
+    state.Read(dot);
+    state.Read(nmi_occurred);
+    state.Read(nmi_output);
+    state.Read(sprite_zero_hit);
+    state.Read(sprite_overflow);
+    state.Read(nametable_base);
+    state.Read(bitmap_shift_0_latch);
+    state.Read(bitmap_shift_1_latch);
+    state.Read(bitmap_shift_0);
+    state.Read(bitmap_shift_1);
+    state.Read(AT_shift_0_latch);
+    state.Read(AT_shift_1_latch);
+    state.Read(AT_shift_0);
+    state.Read(AT_shift_1);
+    state.Read(num_sprites);
+    state.Read(current_frame);
+
+    for(PPUsprite &sprite : sprites) {
+        state.Read(sprite.sprite_index);
+        state.Read(sprite.byte2);
+        state.Read(sprite.pattern_0);
+        state.Read(sprite.pattern_1);
+        state.Read(sprite.attribute);
+        state.Read(sprite.x);
+    }
+    state.Read(sprite_scanline);
+    composeSpriteLine();
+}
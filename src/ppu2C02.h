@@ -1,12 +1,13 @@
 #ifndef PPU2C02_H_INCLUDED
 #define PPU2C02_H_INCLUDED
 
-#include <SDL2/SDL.h>
 #include <functional>
 #include <stdint.h>
 #include <array>
 
 #include "cpu6502.h"
+#include "savestate.h"
+#include "tilecache.h"
 
 class CPU6502state;
 
@@ -20,34 +21,37 @@ class CPU6502state;
 #define PPUDATA 0x2007
 #define OAMDMA 0x4014
 
-static const uint32_t pixelWidth = 2;
-static const uint32_t pixelHeight = 2;
-
-static const uint32_t ppu_colors[64] =
-{
-0x757575, 0x271B8F, 0x0000AB, 0x47009F, 0x8F0077, 0xAB0013, 0xA70000, 0x7F0B00, 0x432F00, 0x004700, 0x005100, 0x003F17, 0x1B3F5F, 0x000000, 0x000000, 0x000000,
-0xBCBCBC, 0x0073EF, 0x233BEF, 0x8300F3, 0xBF00BF, 0xE7005B, 0xDB2B00, 0xCB4F0F, 0x8B7300, 0x009700, 0x00AB00, 0x00933B, 0x00838B, 0x000000, 0x000000, 0x000000,
-0xFFFFFF, 0x3FBFFF, 0x5F97FF, 0xA78BFD, 0xF77BFF, 0xFF77B7, 0xFF7763, 0xFF9B3B, 0xF3BF3F, 0x83D313, 0x4FDF4B, 0x58F898, 0x00EBDB, 0x000000, 0x000000, 0x000000,
-0xFFFFFF, 0xABE7FF, 0xC7D7FF, 0xD7CBFF, 0xFFC7FF, 0xFFC7DB, 0xFFBFB3, 0xFFDBAB, 0xFFE7A3, 0xE3FFA3, 0xABF3BF, 0xB3FFCF, 0x9FFFF3, 0x000000, 0x000000, 0x000000
+//caller-owned 256x240 buffer the PPU renders into, one palette index
+//(0-63) per pixel. video.h turns it into RGB colors.
+struct FrameBuffer {
+    uint8_t *pixels;
 };
+typedef struct FrameBuffer FrameBuffer;
 
 //struct for sprites on the scanline (for secondary OAM)
 struct PPUsprite {
-    uint8_t shifts_remaining;
     uint8_t sprite_index;
     uint8_t byte2;
 
-    uint8_t shift_register_0;
-    uint8_t shift_register_1;
+    uint8_t pattern_0;
+    uint8_t pattern_1;
     uint8_t attribute;
     uint8_t x;
 };
 typedef struct PPUsprite PPUsprite;
 
+//entries of the sprite line buffer hold the sprite color in bits 0-1, its
+//palette in bits 2-3 and these flags
+static const uint8_t SPRITE_BEHIND_BACKGROUND = (1 << 5);
+static const uint8_t SPRITE_ZERO = (1 << 6);
+
 //struct to store the state of the PPU
 class PPU2C02state {
     public:
-        std::array<uint8_t, 0x10000> vram;
+        //nametable RAM. The console has 2 KB, the other 2 KB stand in for
+        //the RAM four-screen cartridges add.
+        std::array<uint8_t, 0x1000> nametable_ram;
+        std::array<uint8_t, 0x20> palette_ram;
         std::array<uint8_t, 0x100> oam;
 
         uint16_t VRAM_address = 0;
@@ -70,13 +74,18 @@ class PPU2C02state {
         uint8_t oamdma = 0;
 
         //initalize the PPU (ppu2C02.c)
-        PPU2C02state(SDL_Surface *screenSurface);
+        PPU2C02state(FrameBuffer frame_buffer);
 
         void SetMapper(std::shared_ptr<Mapper> mapper);
         std::shared_ptr<Mapper> mapper;
 
+        //decoded pattern tables, all rendering reads CHR memory through it
+        TileCache tile_cache;
+
         //Ticking (ppu2C02.c)
         void PPUcycle();
+        void RunCycles(uint32_t cycles);
+        uint32_t CyclesUntilEvent();
         void handleVisibleScanline();
         void horinc();
         void verinc();
@@ -85,22 +94,27 @@ class PPU2C02state {
 
         bool nmi = false;
 
-        SDL_Surface *screenSurface;
+        FrameBuffer frame_buffer;
+
+        //When set, nothing is drawn into frame_buffer. Sprite zero hits are
+        //still detected, so games run exactly as when drawing.
+        bool skip_output = false;
 
         //Rendering stuff (ppu2C02rendering.c)
-        void setPixelColor(SDL_Surface* screenSurface, int x, int y, uint32_t color);
-        void renderPixel(SDL_Surface* screenSurface);
+        void setPixelColor(int x, int y, uint8_t color_index);
+        void renderPixel();
+        void outputPixel(int pixel_x, uint8_t bg_color_index, uint8_t bg_at_index, uint8_t sprite_pixel);
+        void renderScanline();
         void updatePPUrenderingData();
 
         //Loading stuff (ppu2C02rendering.c)
-        uint16_t getSpritePaletteBase(uint8_t attribute_value);
-        uint16_t getBackgroundPaletteBase(uint16_t attribute_value);
-
         void fetchAttribute();
+        uint16_t fetchBackgroundTile(uint16_t pattern_base);
         uint8_t getAttributeTableValue(uint16_t attribute_address, uint8_t x, uint8_t y);
 
         void loadScanlineSprites();
-        int getActiveSpriteIndex();
+        void composeSpriteLine();
+        bool spriteZeroOnScanline();
 
         uint8_t readRegisters(uint16_t address);
         uint8_t writeRegisters(uint16_t address, uint8_t value);
@@ -120,6 +134,7 @@ class PPU2C02state {
         //PPU register values
         uint8_t nmi_output = 0;
         uint8_t sprite_zero_hit = 0;
+        uint8_t sprite_overflow = 0;
 
         //more accurate ppu
         uint16_t nametable_base = 0;
@@ -139,11 +154,49 @@ class PPU2C02state {
         uint8_t num_sprites = 0;
         PPUsprite sprites[8];
 
+        //the sprites of scanline sprite_scanline, composited into one
+        //entry per pixel when they are loaded. Other scanlines have none.
+        std::array<uint8_t, 256> sprite_line = {};
+        uint16_t sprite_scanline = 0xFFFF;
+
         uint GetCurrentFrame() { return current_frame; }
+
+        //Save states (ppu2C02.c)
+        void SaveState(StateWriter &state);
+        void LoadState(StateReader &state);
     
     private:
         uint current_frame = 0;
 
+        //The palette RAM at $3F00-$3F1F resolved to color indices,
+        //including the mirrored sprite backdrop entries. Only rebuilt when
+        //the palette is written, so drawing a pixel is a single lookup.
+        std::array<uint8_t, 32> palette_indices;
+        void updatePalette();
+
+        //OAM entries (0-63) by the scanlines they are on, the first 8 in OAM
+        //order plus the total count. Rebuilt before a line is evaluated if
+        //any sprite Y coordinate was written since.
+        std::array<std::array<uint8_t, 8>, 262> line_sprites;
+        std::array<uint8_t, 262> line_sprite_count;
+        bool sprite_index_dirty = true;
+        void indexSprites();
+
+        //nametable_ram pages backing $2000, $2400, $2800 and $2C00, set up
+        //for the mirroring the mapper asks for
+        uint8_t *nametables[4];
+        Mirroring mirroring;
+        void updateMirroring();
+        uint8_t &nametableByte(uint16_t address) {
+            if( mapper->GetMirroring() != mirroring ) {
+                updateMirroring();
+            }
+            return nametables[(address >> 10) & 3][address & 0x3FF];
+        }
+
+        uint32_t IdleCycles();
+        bool CanRenderScanline();
+
 };
 
 #endif // PPU2C02_H_INCLUDED
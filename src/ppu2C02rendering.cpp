@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <algorithm>
 
 #include "ppu2C02.h"
 
@@ -6,17 +7,16 @@
 /******************
 * rendering
 ******************/
- void PPU2C02state::setPixelColor(SDL_Surface* screenSurface, int x, int y, uint32_t color) {
-    Uint32 *pixels = (Uint32 *)screenSurface->pixels;
-    uint32_t dx = 0, dy=0;
-    for(dx=0; dx<pixelWidth; ++dx) {
-        for(dy=0; dy<pixelHeight; ++dy) {
-            pixels[ ( ((y*pixelHeight)+dy) * screenSurface->w ) + (x*pixelWidth)+dx ] = color;
-        }
-    }
+ void PPU2C02state::setPixelColor(int x, int y, uint8_t color_index) {
+    frame_buffer.pixels[y*256 + x] = color_index;
 }
 
-void PPU2C02state::renderPixel(SDL_Surface* screenSurface) {
+void PPU2C02state::renderPixel() {
+    //without output, only sprite zero can have an effect
+    if( skip_output && !spriteZeroOnScanline() ) {
+        return;
+    }
+
     //get bg color index
     uint8_t shift = 15-(x & 7);
     uint8_t bit_0 = (bitmap_shift_0 & (1 << shift)) >> shift;
@@ -26,123 +26,213 @@ void PPU2C02state::renderPixel(SDL_Surface* screenSurface) {
     bit_1 = (AT_shift_1 & (1 << shift)) >> shift;
     uint8_t bg_at_index = (bit_1 << 1) | bit_0;
 
-    //get sprite color index and active sprite
-    uint8_t sprite_color_index = 0;
-    int active_sprite_index = getActiveSpriteIndex();
-    if( active_sprite_index != -1 ) {
-        bit_0 = (sprites[active_sprite_index].shift_register_0 & (1 << 7)) >> 7;
-        bit_1 = (sprites[active_sprite_index].shift_register_1 & (1 << 7)) >> 7;
-        sprite_color_index = (bit_1 << 1) | bit_0;
+    uint8_t sprite_pixel = 0;
+    if( sprite_scanline == scanline ) {
+        sprite_pixel = sprite_line[dot];
     }
 
+    outputPixel(dot, bg_color_index, bg_at_index, sprite_pixel);
+}
+
+void PPU2C02state::outputPixel(int pixel_x, uint8_t bg_color_index, uint8_t bg_at_index, uint8_t sprite_pixel) {
+    uint8_t sprite_color_index = sprite_pixel & 3;
+
     //draw the pixel on the screen, depending on color and priority
-    if( bg_color_index == 0 && sprite_color_index == 0 ) {
-        setPixelColor(screenSurface, dot, scanline, ppu_colors[readVRAM(0x3F00)]);
-    }
-    else if( (sprite_color_index != 0 && bg_color_index == 0) ||
-             (sprite_color_index != 0 && bg_color_index != 0 && (sprites[active_sprite_index].byte2 & (1<<5)) == 0) ) {
-        assert( active_sprite_index != -1 );
-        uint16_t palette_base = getSpritePaletteBase(sprites[active_sprite_index].attribute);
-        uint8_t color_value = readVRAM(palette_base + sprite_color_index);
-        uint32_t color = ppu_colors[color_value];
-        setPixelColor(screenSurface, dot, scanline, color);
-    }
-    else {
-        uint16_t palette_base = getBackgroundPaletteBase(bg_at_index);
-        uint8_t color_value = readVRAM(palette_base + bg_color_index);
-        uint32_t color = ppu_colors[color_value];
-        setPixelColor(screenSurface, dot, scanline, color);
+    if( !skip_output ) {
+        uint8_t entry;
+        if( bg_color_index == 0 && sprite_color_index == 0 ) {
+            entry = 0;
+        }
+        else if( (sprite_color_index != 0 && bg_color_index == 0) ||
+                 (sprite_color_index != 0 && bg_color_index != 0 && (sprite_pixel & SPRITE_BEHIND_BACKGROUND) == 0) ) {
+            entry = 0x10 | (sprite_pixel & 0x0F);
+        }
+        else {
+            entry = (bg_at_index << 2) | bg_color_index;
+        }
+        setPixelColor(pixel_x, scanline, palette_indices[entry]);
     }
 
     //handle sprite zero hit
-    if( active_sprite_index != -1 && sprites[active_sprite_index].sprite_index == 0 && sprite_color_index != 0 && bg_color_index == 0 ) {
+    if( (sprite_pixel & SPRITE_ZERO) && sprite_color_index != 0 && bg_color_index == 0 ) {
         sprite_zero_hit = 1;
     }
 }
 
+/******************
+* scanline rendering
+******************/
+
+//Renders all dots of the next visible scanline at once. This is only valid
+//if nothing accesses the PPU while the line is drawn, see RunCycles().
+void PPU2C02state::renderScanline() {
+    scanline = (scanline+1) % 262;
+    dot = 0;
+    loadScanlineSprites();
+
+    //background color and attribute indices for the 33 tiles the line
+    //touches. The first two tiles were prefetched into the shift registers
+    //at the end of the previous line.
+    uint8_t bg_color[33*8];
+    uint8_t bg_at[33*8];
+    for(int i=0; i<16; ++i) {
+        uint8_t shift = 15-i;
+        bg_color[i] = (((bitmap_shift_1 >> shift) & 1) << 1) | ((bitmap_shift_0 >> shift) & 1);
+        bg_at[i] = (((AT_shift_1 >> shift) & 1) << 1) | ((AT_shift_0 >> shift) & 1);
+    }
+
+    uint16_t pattern_base = 0x0000;
+    if( ppuctrl & (1 << 4) ) {
+        pattern_base = 0x1000;
+    }
+    //without output, the pixels only matter for sprite zero hits
+    bool output_pixels = !skip_output || spriteZeroOnScanline();
+
+    for(int tile=2; tile<33; ++tile) {
+        uint16_t pattern_address = fetchBackgroundTile(pattern_base);
+        horinc();
+        if( !output_pixels ) {
+            continue;
+        }
+
+        uint8_t at = ((AT_shift_1_latch & 1) << 1) | (AT_shift_0_latch & 1);
+        std::copy_n(tile_cache.GetPixels(pattern_address, false), 8, &bg_color[tile*8]);
+        std::fill_n(&bg_at[tile*8], 8, at);
+    }
+
+    for(int pixel=0; pixel<256 && output_pixels; ++pixel) {
+        outputPixel(pixel, bg_color[pixel+x], bg_at[pixel+x], sprite_line[pixel]);
+    }
+
+    //dot 256-257
+    verinc();
+    VRAM_address &= 31712;
+    VRAM_address |= (t & ~31712);
+
+    //dot 321-336, prefetch the first two tiles of the next line
+    for(int tile=0; tile<2; ++tile) {
+        fetchBackgroundTile(pattern_base);
+        bitmap_shift_0 = (bitmap_shift_0 << 8) | bitmap_shift_0_latch;
+        bitmap_shift_1 = (bitmap_shift_1 << 8) | bitmap_shift_1_latch;
+        AT_shift_0 = (AT_shift_0 << 8) | AT_shift_0_latch;
+        AT_shift_1 = (AT_shift_1 << 8) | AT_shift_1_latch;
+        horinc();
+    }
+
+    dot = 340;
+}
+
+//loads the latches with the nametable tile VRAM_address points at,
+//returns the address of the tile row
+uint16_t PPU2C02state::fetchBackgroundTile(uint16_t pattern_base) {
+    nametable_base = (0x2000 | (VRAM_address & 0x0FFF));
+    fetchAttribute();
+
+    uint16_t pattern_index = readVRAM(nametable_base);
+    uint8_t row = ((VRAM_address&0x7000) >> 12);
+    uint16_t pattern_address = pattern_base + pattern_index*16+row;
+    bitmap_shift_0_latch = tile_cache.GetPattern(pattern_address);
+    bitmap_shift_1_latch = tile_cache.GetPattern(pattern_address+8);
+    return pattern_address;
+}
+
 /******************
 * loading
 ******************/
 
  void PPU2C02state::loadScanlineSprites() {
-    num_sprites = 0;
-    int i=0;
-    for(i=0; i<8; ++i) {
-        sprites[i].shift_register_0 = 0;
-        sprites[i].shift_register_1 = 0;
+    if( sprite_index_dirty ) {
+        indexSprites();
     }
 
-    for(i=0x00; i<0xFF; i+=4) {
+    //more than 8 sprites on a visible line set the overflow flag
+    uint8_t count = line_sprite_count[scanline];
+    if( count > 8 && scanline < 240 ) {
+        sprite_overflow = 1;
+    }
 
-        uint8_t y = readSPRRAM(i+0)+1;
+    num_sprites = std::min<uint8_t>(count, 8);
+    for(int n=0; n<num_sprites; ++n) {
+        int i = line_sprites[scanline][n]*4;
+
+        int y = readSPRRAM(i+0)+1;
         uint8_t pattern_index = readSPRRAM(i+1);
         uint8_t byte2 = readSPRRAM(i+2);
         uint8_t x = readSPRRAM(i+3);
 
-        if( y <= scanline && y+8 > scanline ) {
+        uint16_t pattern_base = 0x0000;
+        if( (ppuctrl & (1 << 3)) ) {
+            pattern_base = 0x1000;
+        }
 
-            uint16_t pattern_base = 0x0000;
-            if( (ppuctrl & (1 << 3)) ) {
-                pattern_base = 0x1000;
-            }
+        //flip y
+        int row = scanline-y;
+        if( byte2 & (1 << 7) ) {
+            row = 7-row;
+        }
 
-            int row = scanline-y;
-            uint8_t pattern_0 = readVRAM(pattern_base + (pattern_index*16+row));
-            uint8_t pattern_1 = readVRAM(pattern_base + (pattern_index*16+row+8));
+        //flip x, the cache holds the patterns with their bits reversed
+        bool flip_x = (byte2 & (1 << 6)) != 0;
+        uint16_t pattern_address = pattern_base + pattern_index*16+row;
+        uint8_t pattern_0 = tile_cache.GetPattern(pattern_address, flip_x);
+        uint8_t pattern_1 = tile_cache.GetPattern(pattern_address+8, flip_x);
 
-            //flip y
-            if( byte2 & (1 << 7) ) {
-                pattern_0 = readVRAM(pattern_base + (pattern_index*16+(7-row)));
-                pattern_1 = readVRAM(pattern_base + (pattern_index*16+(7-row)+8));
-            }
+        sprites[n].sprite_index = i;
+        sprites[n].x = x;
+        sprites[n].attribute = (byte2 & 3);
+        sprites[n].pattern_0 = pattern_0;
+        sprites[n].pattern_1 = pattern_1;
+        sprites[n].byte2 = byte2;
+    }
 
-            //flip x, reverse the bits in the patterns
-            if(byte2 & (1 << 6) ) {
-                uint8_t new_pattern_0 = 0;
-                uint8_t new_pattern_1 = 0;
-                int bit;
-                for(bit=0; bit<8; ++bit) {
-                    new_pattern_0 <<= 1;
-                    new_pattern_0 |= (pattern_0&1);
-                    pattern_0 >>= 1;
-                    new_pattern_1 <<= 1;
-                    new_pattern_1 |= (pattern_1&1);
-                    pattern_1 >>= 1;
-                }
-                pattern_0 = new_pattern_0;
-                pattern_1 = new_pattern_1;
-            }
+    composeSpriteLine();
+    sprite_scanline = scanline;
+}
 
-            sprites[num_sprites].sprite_index = i;
-            sprites[num_sprites].x = x;
-            sprites[num_sprites].attribute = (byte2 & 3);
-            sprites[num_sprites].shift_register_0 = pattern_0;
-            sprites[num_sprites].shift_register_1 = pattern_1;
-            sprites[num_sprites].shifts_remaining = 8;
-            sprites[num_sprites].byte2 = byte2;
-
-            num_sprites += 1;
-            if(num_sprites == 8) {
-                break;
+//sorts the OAM entries into the lines they cover, a sprite at Y covers
+//lines Y+1 to Y+8. Y is not wrapped, sprites hidden at $EF-$FF stay below
+//the picture instead of landing on the top lines
+ void PPU2C02state::indexSprites() {
+    line_sprite_count.fill(0);
+    for(int sprite=0; sprite<64; ++sprite) {
+        int y = readSPRRAM(sprite*4)+1;
+        for(int line=y; line<y+8 && line<262; ++line) {
+            if( line_sprite_count[line] < 8 ) {
+                line_sprites[line][line_sprite_count[line]] = sprite;
             }
+            line_sprite_count[line] += 1;
         }
     }
+    sprite_index_dirty = false;
+}
 
+ bool PPU2C02state::spriteZeroOnScanline() {
+    for(int i=0; i<num_sprites; ++i) {
+        if( sprites[i].sprite_index == 0 ) {
+            return true;
+        }
+    }
+    return false;
 }
 
- int PPU2C02state::getActiveSpriteIndex() {
-    uint8_t i;
-    for(i=0; i<num_sprites; ++i) {
-        if( sprites[i].x == 0 && sprites[i].shifts_remaining > 0 ) {
-            uint8_t bit_0 = (sprites[i].shift_register_0 & (1 << 7)) >> 7;
-            uint8_t bit_1 = (sprites[i].shift_register_1 & (1 << 7)) >> 7;
-            uint8_t bg_color_index = (bit_1 << 1) | bit_0;
-            if( bg_color_index > 0 ) {
-                return i;
+//draws the loaded sprites into sprite_line, lower sprite indices have
+//priority so they are drawn last
+ void PPU2C02state::composeSpriteLine() {
+    sprite_line.fill(0);
+    for(int i=num_sprites-1; i>=0; --i) {
+        uint8_t flags = (sprites[i].attribute << 2) | (sprites[i].byte2 & SPRITE_BEHIND_BACKGROUND);
+        if( sprites[i].sprite_index == 0 ) {
+            flags |= SPRITE_ZERO;
+        }
+        for(int column=0; column<8 && sprites[i].x+column < 256; ++column) {
+            uint8_t bit_0 = (sprites[i].pattern_0 >> (7-column)) & 1;
+            uint8_t bit_1 = (sprites[i].pattern_1 >> (7-column)) & 1;
+            uint8_t color = (bit_1 << 1) | bit_0;
+            if( color != 0 ) {
+                sprite_line[sprites[i].x+column] = flags | color;
             }
         }
     }
-    return -1;
 }
 
  void PPU2C02state::updatePPUrenderingData() {
@@ -155,52 +245,12 @@ void PPU2C02state::renderPixel(SDL_Surface* screenSurface) {
     AT_shift_1 <<= 1;
     AT_shift_0 &= ~1;
     AT_shift_1 &= ~1;
-
-    int i;
-    for(i=0; i<num_sprites; ++i) {
-        if( sprites[i].x == 0 && sprites[i].shifts_remaining > 0) {
-            sprites[i].shift_register_0 <<= 1;
-            sprites[i].shift_register_1 <<= 1;
-            sprites[i].shifts_remaining -= 1;
-        }
-        else {
-            sprites[i].x -= 1;
-        }
-    }
 }
 
 /******************
 * fetching values
 ******************/
 
- uint16_t PPU2C02state::getSpritePaletteBase(uint8_t attribute_value) {
-    switch(attribute_value) {
-        case 0:
-            return 0x3F10;
-        case 1:
-            return 0x3F14;
-        case 2:
-            return 0x3F18;
-        case 3:
-            return 0x3F1C;
-    }
-    return 0x3F10;
-}
-
- uint16_t PPU2C02state::getBackgroundPaletteBase(uint16_t attribute_value) {
-    switch(attribute_value) {
-        case 0:
-            return 0x3F00;
-        case 1:
-            return 0x3F04;
-        case 2:
-            return 0x3F08;
-        case 3:
-            return 0x3F0C;
-    }
-    return 0x3F00;
-}
-
  void PPU2C02state::fetchAttribute() {
     uint16_t attribute_address = (0x23C0 | (VRAM_address & 0x0C00) | ((VRAM_address >> 4) & 0x38) | ((VRAM_address >> 2) & 0x07));
     uint8_t at = getAttributeTableValue(attribute_address, (VRAM_address & 0x001F)*8, ((VRAM_address & (0x001F << 5)) >> 5)*8);
@@ -0,0 +1,172 @@
+#include <string.h>
+
+#include "rewind.h"
+
+// Literal runs are only ended by at least this many equal bytes, shorter
+// runs cost more to encode than to copy
+static const size_t min_equal_run = 8;
+
+static void WriteVarint(std::vector<uint8_t> &data, size_t value) {
+    while(value >= 0x80) {
+        data.push_back( (value & 0x7F) | 0x80 );
+        value >>= 7;
+    }
+    data.push_back(value);
+}
+
+static bool ReadVarint(const std::vector<uint8_t> &data, size_t &position, size_t &value) {
+    value = 0;
+    for(size_t shift=0; position < data.size() && shift < 64; shift += 7) {
+        uint8_t byte = data[position++];
+        value |= (size_t)(byte & 0x7F) << shift;
+        if( !(byte & 0x80) ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void EncodeDelta(const uint8_t *state, const uint8_t *base, size_t size, std::vector<uint8_t> &delta) {
+    delta.clear();
+
+    size_t i = 0;
+    while(i < size) {
+        size_t equal_start = i;
+        while(i+8 <= size && memcmp(state+i, base+i, 8) == 0) {
+            i += 8;
+        }
+        while(i < size && state[i] == base[i]) {
+            ++i;
+        }
+
+        size_t literal_start = i;
+        while(i < size) {
+            if(state[i] != base[i]) {
+                ++i;
+                continue;
+            }
+            size_t run = 0;
+            while(i+run < size && run < min_equal_run && state[i+run] == base[i+run]) {
+                ++run;
+            }
+            if(run == min_equal_run || i+run == size) {
+                break;
+            }
+            i += run;
+        }
+
+        WriteVarint(delta, literal_start - equal_start);
+        WriteVarint(delta, i - literal_start);
+        for(size_t j=literal_start; j<i; ++j) {
+            delta.push_back(state[j] ^ base[j]);
+        }
+    }
+}
+
+bool DecodeDelta(const std::vector<uint8_t> &delta, const uint8_t *base, size_t size, std::vector<uint8_t> &state) {
+    state.resize(size);
+
+    size_t position = 0;
+    size_t i = 0;
+    while(position < delta.size()) {
+        size_t equal = 0;
+        size_t literal = 0;
+        if(!ReadVarint(delta, position, equal) || !ReadVarint(delta, position, literal)) {
+            return false;
+        }
+        if(equal > size-i || literal > size-i-equal || literal > delta.size()-position) {
+            return false;
+        }
+
+        memcpy(state.data()+i, base+i, equal);
+        i += equal;
+        for(size_t j=0; j<literal; ++j, ++i) {
+            state[i] = base[i] ^ delta[position++];
+        }
+    }
+    return i == size;
+}
+
+RewindBuffer::RewindBuffer(size_t max_bytes, uint32_t keyframe_interval) {
+    this->max_bytes = max_bytes;
+    this->keyframe_interval = keyframe_interval > 0 ? keyframe_interval : 1;
+}
+
+void RewindBuffer::Push(const std::vector<uint8_t> &state) {
+    Entry entry;
+    entry.is_keyframe = entries.empty() || since_keyframe >= keyframe_interval || keyframe.size() != state.size();
+
+    if(entry.is_keyframe) {
+        zeros.resize(state.size(), 0);
+        EncodeDelta(state.data(), zeros.data(), state.size(), entry.data);
+        keyframe = state;
+        since_keyframe = 0;
+    }
+    else {
+        EncodeDelta(state.data(), keyframe.data(), state.size(), entry.data);
+    }
+    since_keyframe += 1;
+
+    entry.data.shrink_to_fit();
+    used_bytes += entry.data.size();
+    entries.push_back(std::move(entry));
+
+    // never drop the group the new state belongs to
+    while(used_bytes > max_bytes && entries.size() > since_keyframe) {
+        DropOldest();
+    }
+}
+
+bool RewindBuffer::Pop(std::vector<uint8_t> &state) {
+    if(entries.empty()) {
+        return false;
+    }
+
+    Entry &entry = entries.back();
+    bool decoded;
+    if(entry.is_keyframe) {
+        decoded = DecodeDelta(entry.data, zeros.data(), zeros.size(), state);
+    }
+    else {
+        decoded = DecodeDelta(entry.data, keyframe.data(), keyframe.size(), state);
+    }
+
+    used_bytes -= entry.data.size();
+    bool was_keyframe = entry.is_keyframe;
+    entries.pop_back();
+
+    since_keyframe -= 1;
+    if(was_keyframe) {
+        DecodeNewestKeyframe();
+    }
+    return decoded;
+}
+
+void RewindBuffer::Clear() {
+    entries.clear();
+    used_bytes = 0;
+    keyframe.clear();
+    since_keyframe = 0;
+}
+
+void RewindBuffer::DropOldest() {
+    do {
+        used_bytes -= entries.front().data.size();
+        entries.pop_front();
+    } while(!entries.empty() && !entries.front().is_keyframe);
+}
+
+// Finds the keyframe the newest remaining entry depends on after its own
+// keyframe was popped
+void RewindBuffer::DecodeNewestKeyframe() {
+    keyframe.clear();
+    since_keyframe = 0;
+    for(auto it = entries.rbegin(); it != entries.rend(); ++it) {
+        since_keyframe += 1;
+        if(it->is_keyframe) {
+            DecodeDelta(it->data, zeros.data(), zeros.size(), keyframe);
+            return;
+        }
+    }
+    since_keyframe = 0;
+}
@@ -0,0 +1,62 @@
+#ifndef REWIND_H_INCLUDED
+#define REWIND_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+// Bounded history of save states, newest last.
+// Every keyframe_interval-th state is a keyframe, the ones in between are
+// stored as the XOR against their keyframe. Both are run-length encoded,
+// so the parts of a state that rarely change (most of VRAM, mapper RAM)
+// cost next to nothing. When the history grows past max_bytes, the oldest
+// keyframe is dropped together with the states depending on it.
+class RewindBuffer {
+    public:
+        RewindBuffer(size_t max_bytes, uint32_t keyframe_interval = 60);
+
+        void Push(const std::vector<uint8_t> &state);
+
+        // Removes the newest state and decodes it into state.
+        // Returns false if the history is empty.
+        bool Pop(std::vector<uint8_t> &state);
+
+        void Clear();
+
+        size_t Size() const { return entries.size(); }
+        size_t MemoryUsage() const { return used_bytes; }
+
+    private:
+        struct Entry {
+            bool is_keyframe;
+            std::vector<uint8_t> data;
+        };
+
+        std::deque<Entry> entries;
+        size_t max_bytes;
+        uint32_t keyframe_interval;
+        size_t used_bytes = 0;
+
+        // Decoded copy of the keyframe the newest entry depends on, and the
+        // number of entries pushed since it
+        std::vector<uint8_t> keyframe;
+        uint32_t since_keyframe = 0;
+
+        // All zero, used as the base keyframes are encoded against
+        std::vector<uint8_t> zeros;
+
+        void DropOldest();
+        void DecodeNewestKeyframe();
+};
+
+// XOR encodes state against base and run-length encodes the result.
+// The encoding is a sequence of (equal bytes, literal bytes) varint pairs,
+// each followed by the XORed literal bytes.
+void EncodeDelta(const uint8_t *state, const uint8_t *base, size_t size, std::vector<uint8_t> &delta);
+
+// Applies a delta made by EncodeDelta() to base, returns false if the delta
+// does not fit a state of the given size
+bool DecodeDelta(const std::vector<uint8_t> &delta, const uint8_t *base, size_t size, std::vector<uint8_t> &state);
+
+#endif // REWIND_H_INCLUDED
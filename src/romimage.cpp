@@ -0,0 +1,80 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#include "romimage.h"
+
+// A file is identified by its device and inode, plus its size and
+// modification time so a ROM rewritten in place is mapped again
+typedef std::tuple<dev_t, ino_t, off_t, time_t, long> RomKey;
+
+static std::mutex open_images_mutex;
+static std::map< RomKey, std::weak_ptr<const RomImage> > open_images;
+
+std::shared_ptr<const RomImage> RomImage::Open(const std::string &filename) {
+    int file = open(filename.c_str(), O_RDONLY);
+    if(file < 0) {
+        std::cerr << "Error: Could not load the file " << filename << std::endl;
+        return NULL;
+    }
+
+    struct stat info;
+    if(fstat(file, &info) != 0) {
+        std::cerr << "Error: Could not load the file " << filename << std::endl;
+        close(file);
+        return NULL;
+    }
+    RomKey key(info.st_dev, info.st_ino, info.st_size, info.st_mtim.tv_sec, info.st_mtim.tv_nsec);
+
+    std::lock_guard<std::mutex> lock(open_images_mutex);
+    for(auto it = open_images.begin(); it != open_images.end(); ) {
+        it = it->second.expired() ? open_images.erase(it) : std::next(it);
+    }
+    bool regular = S_ISREG(info.st_mode);
+    if(regular) {
+        auto it = open_images.find(key);
+        if(it != open_images.end()) {
+            if(std::shared_ptr<const RomImage> image = it->second.lock()) {
+                close(file);
+                return image;
+            }
+        }
+    }
+
+    std::shared_ptr<RomImage> image(new RomImage());
+    if(regular && info.st_size > 0) {
+        void *mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if(mapping != MAP_FAILED) {
+            image->data = (const uint8_t*)mapping;
+            image->size = info.st_size;
+            image->mapped = true;
+        }
+    }
+
+    if(!image->mapped) {
+        uint8_t buffer[0x4000];
+        ssize_t length;
+        while( (length = read(file, buffer, sizeof(buffer))) > 0 ) {
+            image->contents.insert(image->contents.end(), buffer, buffer+length);
+        }
+        image->data = image->contents.data();
+        image->size = image->contents.size();
+    }
+    close(file);
+
+    if(regular) {
+        open_images[key] = image;
+    }
+    return image;
+}
+
+RomImage::~RomImage() {
+    if(mapped) {
+        munmap((void*)data, size);
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef ROMIMAGE_H_INCLUDED
+#define ROMIMAGE_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Read-only contents of a ROM file, mapped into memory instead of read, so
+// pages are only loaded when touched and are shared with every other
+// process mapping the same file. Opening a file that is already open in
+// this process returns the same image, so consoles running the same ROM
+// share its banks.
+class RomImage {
+    public:
+        // Returns NULL if the file can not be opened
+        static std::shared_ptr<const RomImage> Open(const std::string &filename);
+
+        ~RomImage();
+
+        RomImage(const RomImage&) = delete;
+        RomImage &operator=(const RomImage&) = delete;
+
+        const uint8_t *Data() const { return data; }
+        size_t Size() const { return size; }
+
+    private:
+        RomImage() {}
+
+        const uint8_t *data = NULL;
+        size_t size = 0;
+        bool mapped = false;
+
+        // used instead of a mapping for files that can not be mapped, such
+        // as pipes
+        std::vector<uint8_t> contents;
+};
+
+#endif // ROMIMAGE_H_INCLUDED
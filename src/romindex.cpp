@@ -0,0 +1,237 @@
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include "romindex.h"
+#include "romimage.h"
+#include "savestate.h"
+#include "threadpool.h"
+
+// Layout of an index file, integers little-endian as in save states:
+//   "NESLIGIX"            8 bytes
+//   version               uint32
+//   entry count           uint32
+//   entries               path length (uint16) and characters, file size
+//                         (uint64), modification time (int64), CRC-32
+//                         (uint32), SHA-1 (20 bytes), mapper (uint16),
+//                         submapper (uint8), flags (uint8), PRG ROM and
+//                         CHR ROM size (uint64), PRG RAM and CHR RAM size
+//                         (uint32)
+// Flags are bit 0 NES 2.0, bit 1 battery, bit 2 trainer and bits 4-6 the
+// mirroring.
+static const char romindex_magic[8] = {'N', 'E', 'S', 'L', 'I', 'G', 'I', 'X'};
+static const uint32_t romindex_version = 1;
+
+static size_t threadCount(size_t threads) {
+    if(threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    return threads > 0 ? threads : 1;
+}
+
+static bool isRomFile(const std::filesystem::path &path) {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == ".nes";
+}
+
+bool ReadRomEntry(RomIndexEntry &entry) {
+    std::shared_ptr<const RomImage> image = RomImage::Open(entry.path);
+    if(!image) {
+        return false;
+    }
+    if(!ParseRomHeader(image->Data(), image->Size(), entry.header) || image->Size() < entry.header.RomEnd()) {
+        return false;
+    }
+
+    const uint8_t *rom = image->Data() + entry.header.PrgRomOffset();
+    size_t rom_size = entry.header.RomEnd() - entry.header.PrgRomOffset();
+    entry.crc32 = Crc32(rom, rom_size);
+    Sha1 sha1;
+    sha1.Update(rom, rom_size);
+    entry.sha1 = sha1.Final();
+    return true;
+}
+
+size_t RomIndex::Scan(const std::string &directory, size_t threads) {
+    namespace fs = std::filesystem;
+
+    std::vector<RomIndexEntry> found;
+    std::error_code error;
+    fs::recursive_directory_iterator it(directory, fs::directory_options::skip_permission_denied, error);
+    for(; !error && it != fs::recursive_directory_iterator(); it.increment(error)) {
+        std::error_code status_error;
+        if(!it->is_regular_file(status_error) || !isRomFile(it->path())) {
+            continue;
+        }
+        struct stat info;
+        if(stat(it->path().c_str(), &info) != 0) {
+            continue;
+        }
+        RomIndexEntry entry;
+        entry.path = it->path().string();
+        entry.file_size = info.st_size;
+        entry.modified = (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+        found.push_back(entry);
+    }
+    if(error) {
+        std::cerr << "Error: Could not scan " << directory << ": " << error.message() << std::endl;
+    }
+    std::sort(found.begin(), found.end(), [](const RomIndexEntry &a, const RomIndexEntry &b) {
+        return a.path < b.path;
+    });
+
+    // unchanged files keep their entry, the rest are read in parallel
+    std::unordered_map<std::string, const RomIndexEntry*> previous;
+    for(const RomIndexEntry &entry : entries) {
+        previous[entry.path] = &entry;
+    }
+    std::vector<uint8_t> valid(found.size(), 1);
+    std::vector<size_t> changed;
+    for(size_t i=0; i<found.size(); ++i) {
+        auto match = previous.find(found[i].path);
+        if(match != previous.end() && match->second->file_size == found[i].file_size && match->second->modified == found[i].modified) {
+            found[i] = *match->second;
+        }
+        else {
+            changed.push_back(i);
+        }
+    }
+
+    ThreadPool pool(threadCount(threads));
+    pool.ParallelFor(changed.size(), [&](size_t i) {
+        valid[changed[i]] = ReadRomEntry(found[changed[i]]);
+    });
+
+    entries.clear();
+    for(size_t i=0; i<found.size(); ++i) {
+        if(valid[i]) {
+            entries.push_back(std::move(found[i]));
+        }
+    }
+    BuildLookups();
+    return changed.size();
+}
+
+bool RomIndex::Save(const std::string &filename) const {
+    std::vector<uint8_t> data;
+    StateWriter index(data);
+    index.Write((const uint8_t*)romindex_magic, sizeof(romindex_magic));
+    index.Write(romindex_version);
+    index.Write((uint32_t)entries.size());
+
+    for(const RomIndexEntry &entry : entries) {
+        const RomHeader &header = entry.header;
+        index.Write((uint16_t)entry.path.size());
+        index.Write((const uint8_t*)entry.path.data(), (uint16_t)entry.path.size());
+        index.Write(entry.file_size);
+        index.Write(entry.modified);
+        index.Write(entry.crc32);
+        index.Write(entry.sha1);
+        index.Write(header.mapper);
+        index.Write(header.submapper);
+        index.Write((uint8_t)(header.nes2 | (header.battery << 1) | (header.trainer << 2) | ((int)header.mirroring << 4)));
+        index.Write(header.prg_rom_size);
+        index.Write(header.chr_rom_size);
+        index.Write(header.prg_ram_size);
+        index.Write(header.chr_ram_size);
+    }
+
+    std::ofstream out(filename, std::ios_base::binary);
+    out.write((const char*)data.data(), data.size());
+    if(!out) {
+        std::cerr << "Error: Could not write the ROM index " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool RomIndex::Load(const std::string &filename) {
+    std::ifstream in(filename, std::ios_base::binary);
+    if(!in) {
+        std::cerr << "Error: Could not load the ROM index " << filename << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> data(
+         (std::istreambuf_iterator<char>(in)),
+         (std::istreambuf_iterator<char>()));
+
+    StateReader index(data.data(), data.size());
+    char magic[sizeof(romindex_magic)];
+    uint32_t version = 0;
+    index.Read((uint8_t*)magic, sizeof(magic));
+    index.Read(version);
+    if(index.Failed() || memcmp(magic, romindex_magic, sizeof(magic)) != 0 || version != romindex_version) {
+        std::cerr << "Error: " << filename << " is not a ROM index of version " << romindex_version << std::endl;
+        return false;
+    }
+
+    uint32_t count = 0;
+    index.Read(count);
+    std::vector<RomIndexEntry> loaded;
+    for(uint32_t i=0; i<count && !index.Failed(); ++i) {
+        RomIndexEntry entry;
+        RomHeader &header = entry.header;
+        uint16_t path_length = 0;
+        uint8_t flags = 0;
+        index.Read(path_length);
+        entry.path.resize(path_length);
+        index.Read((uint8_t*)entry.path.data(), path_length);
+        index.Read(entry.file_size);
+        index.Read(entry.modified);
+        index.Read(entry.crc32);
+        index.Read(entry.sha1);
+        index.Read(header.mapper);
+        index.Read(header.submapper);
+        index.Read(flags);
+        index.Read(header.prg_rom_size);
+        index.Read(header.chr_rom_size);
+        index.Read(header.prg_ram_size);
+        index.Read(header.chr_ram_size);
+        header.nes2 = flags & (1 << 0);
+        header.battery = flags & (1 << 1);
+        header.trainer = flags & (1 << 2);
+        header.mirroring = (Mirroring)((flags >> 4) & 7);
+        loaded.push_back(std::move(entry));
+    }
+    if(index.Failed() || index.Remaining() != 0) {
+        std::cerr << "Error: The ROM index " << filename << " is truncated" << std::endl;
+        return false;
+    }
+
+    entries = std::move(loaded);
+    BuildLookups();
+    return true;
+}
+
+size_t RomIndex::Sha1Hasher::operator()(const Sha1Digest &sha1) const {
+    // the digest is already uniformly distributed
+    size_t hash;
+    memcpy(&hash, sha1.data(), sizeof(hash));
+    return hash;
+}
+
+void RomIndex::BuildLookups() {
+    by_crc32.clear();
+    by_sha1.clear();
+    by_crc32.reserve(entries.size());
+    by_sha1.reserve(entries.size());
+    for(size_t i=0; i<entries.size(); ++i) {
+        by_crc32.emplace(entries[i].crc32, i);
+        by_sha1.emplace(entries[i].sha1, i);
+    }
+}
+
+const RomIndexEntry *RomIndex::FindByCrc32(uint32_t crc32) const {
+    auto match = by_crc32.find(crc32);
+    return match != by_crc32.end() ? &entries[match->second] : NULL;
+}
+
+const RomIndexEntry *RomIndex::FindBySha1(const Sha1Digest &sha1) const {
+    auto match = by_sha1.find(sha1);
+    return match != by_sha1.end() ? &entries[match->second] : NULL;
+}
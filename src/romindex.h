@@ -0,0 +1,65 @@
+#ifndef ROMINDEX_H_INCLUDED
+#define ROMINDEX_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "filereader.h"
+#include "hash.h"
+
+// A ROM found by RomIndex::Scan(). The hashes cover PRG and CHR ROM but
+// not the header or trainer, the way ROM databases identify games.
+struct RomIndexEntry {
+    std::string path;
+    uint64_t file_size = 0;
+    int64_t modified = 0; // nanoseconds since the epoch
+
+    uint32_t crc32 = 0;
+    Sha1Digest sha1 = {};
+    RomHeader header;
+};
+
+// Reads the header and hashes of the ROM at entry.path. Returns false if
+// the file is not a complete iNES file.
+bool ReadRomEntry(RomIndexEntry &entry);
+
+// The headers and hashes of a directory tree of ROMs, saved to a compact
+// index file so jobs can pick games by hash or mapper without opening
+// every ROM. Lookups by hash are O(1).
+class RomIndex {
+    public:
+        // Indexes every .nes file below directory, replacing the previous
+        // entries. Files whose size and modification time match their
+        // previous entry are not read again, files that are not iNES files
+        // are left out and read on every scan. Files are hashed on threads
+        // threads, 0 uses one per hardware thread. Returns the number of
+        // files that were read.
+        size_t Scan(const std::string &directory, size_t threads = 0);
+
+        bool Save(const std::string &filename) const;
+        bool Load(const std::string &filename);
+
+        // NULL if there is no such ROM. If the same ROM is in several
+        // files, the first path in sorted order is returned.
+        const RomIndexEntry *FindByCrc32(uint32_t crc32) const;
+        const RomIndexEntry *FindBySha1(const Sha1Digest &sha1) const;
+
+        // Sorted by path
+        const std::vector<RomIndexEntry> &Entries() const { return entries; }
+
+    private:
+        struct Sha1Hasher {
+            size_t operator()(const Sha1Digest &sha1) const;
+        };
+
+        std::vector<RomIndexEntry> entries;
+        std::unordered_map<uint32_t, size_t> by_crc32;
+        std::unordered_map<Sha1Digest, size_t, Sha1Hasher> by_sha1;
+
+        void BuildLookups();
+};
+
+#endif // ROMINDEX_H_INCLUDED
@@ -0,0 +1,113 @@
+#include <string.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include "savestate.h"
+#include "cpu6502.h"
+#include "ppu2C02.h"
+
+// Layout of a save state:
+//   "NESLIGST"            8 bytes
+//   version               uint32
+//   mapper id             uint8 length, followed by the characters
+//   payload size          uint32
+//   payload               mapper, PPU, APU and CPU state, in that order
+// The CPU comes last since loading it remaps the mapper's PRG pages.
+static const char savestate_magic[8] = {'N', 'E', 'S', 'L', 'I', 'G', 'S', 'T'};
+
+void SaveState(CPU6502state &cpu, std::vector<uint8_t> &data) {
+    data.clear();
+    StateWriter state(data);
+
+    state.Write((const uint8_t*)savestate_magic, sizeof(savestate_magic));
+    state.Write(savestate_version);
+
+    const std::string &mapper_id = cpu.mapper->GetId();
+    state.Write((uint8_t)mapper_id.size());
+    state.Write((const uint8_t*)mapper_id.data(), (uint8_t)mapper_id.size());
+
+    size_t size_position = data.size();
+    state.Write((uint32_t)0);
+    size_t payload_start = data.size();
+
+    cpu.mapper->SaveState(state);
+    cpu.ppu->SaveState(state);
+    cpu.apu.SaveState(state);
+    cpu.SaveState(state);
+
+    uint32_t payload_size = data.size() - payload_start;
+    for(size_t i=0; i<4; ++i) {
+        data[size_position+i] = payload_size >> (8*i);
+    }
+}
+
+bool LoadState(CPU6502state &cpu, const uint8_t *data, size_t size) {
+    StateReader state(data, size);
+
+    char magic[sizeof(savestate_magic)];
+    state.Read((uint8_t*)magic, sizeof(magic));
+    if(state.Failed() || memcmp(magic, savestate_magic, sizeof(magic)) != 0) {
+        std::cerr << "Error: Not a save state" << std::endl;
+        return false;
+    }
+
+    uint32_t version = 0;
+    state.Read(version);
+    if(version != savestate_version) {
+        std::cerr << "Error: Save state version " << version << " is not supported" << std::endl;
+        return false;
+    }
+
+    uint8_t id_length = 0;
+    state.Read(id_length);
+    std::string mapper_id(id_length, '\0');
+    state.Read((uint8_t*)mapper_id.data(), id_length);
+    if(mapper_id != cpu.mapper->GetId()) {
+        std::cerr << "Error: Save state is for " << mapper_id << ", not " << cpu.mapper->GetId() << std::endl;
+        return false;
+    }
+
+    // The payload layout is fixed for a given version and mapper, so a
+    // payload of the right size can be loaded without partial failures
+    uint32_t payload_size = 0;
+    state.Read(payload_size);
+    if(state.Failed() || payload_size != state.Remaining()) {
+        std::cerr << "Error: Save state is truncated" << std::endl;
+        return false;
+    }
+
+    cpu.mapper->LoadState(state);
+    cpu.ppu->LoadState(state);
+    cpu.apu.LoadState(state);
+    cpu.LoadState(state);
+
+    return !state.Failed() && state.Remaining() == 0;
+}
+
+bool SaveStateFile(CPU6502state &cpu, const std::string &filename) {
+    std::vector<uint8_t> data;
+    SaveState(cpu, data);
+
+    std::ofstream out(filename, std::ios_base::binary);
+    out.write((const char*)data.data(), data.size());
+    if(!out) {
+        std::cerr << "Error: Could not write the save state " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool LoadStateFile(CPU6502state &cpu, const std::string &filename) {
+    std::ifstream in(filename, std::ios_base::binary);
+    if(!in) {
+        std::cerr << "Error: Could not load the save state " << filename << std::endl;
+        return false;
+    }
+
+    std::vector<uint8_t> data(
+         (std::istreambuf_iterator<char>(in)),
+         (std::istreambuf_iterator<char>()));
+
+    return LoadState(cpu, data.data(), data.size());
+}
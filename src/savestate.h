@@ -0,0 +1,108 @@
+#ifndef SAVESTATE_H_INCLUDED
+#define SAVESTATE_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <array>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+class CPU6502state;
+
+// Bumped whenever the layout of any saved component changes.
+// States with a different version are rejected.
+static const uint32_t savestate_version = 6;
+
+// Appends the state of a component to a byte buffer. Integers are stored
+// little-endian so states can be moved between hosts.
+class StateWriter {
+    public:
+        StateWriter(std::vector<uint8_t> &data) : data(data) {}
+
+        template<typename T>
+        void Write(const T &value) {
+            static_assert(std::is_integral<T>::value, "only integers can be written");
+            for(size_t i=0; i<sizeof(T); ++i) {
+                data.push_back( (uint64_t)value >> (8*i) );
+            }
+        }
+
+        void Write(const uint8_t *bytes, size_t length) {
+            size_t position = data.size();
+            data.resize(position + length);
+            memcpy(data.data() + position, bytes, length);
+        }
+
+        template<size_t N>
+        void Write(const std::array<uint8_t, N> &bytes) {
+            Write(bytes.data(), N);
+        }
+
+    private:
+        std::vector<uint8_t> &data;
+};
+
+// Reads back what StateWriter wrote. Reading past the end of the buffer
+// yields zeros and marks the reader as failed.
+class StateReader {
+    public:
+        StateReader(const uint8_t *data, size_t size) : data(data), size(size) {}
+
+        template<typename T>
+        void Read(T &value) {
+            static_assert(std::is_integral<T>::value, "only integers can be read");
+            uint64_t result = 0;
+            if(Available(sizeof(T))) {
+                for(size_t i=0; i<sizeof(T); ++i) {
+                    result |= (uint64_t)data[position++] << (8*i);
+                }
+            }
+            value = (T)result;
+        }
+
+        void Read(uint8_t *bytes, size_t length) {
+            if(Available(length)) {
+                memcpy(bytes, data+position, length);
+                position += length;
+            }
+            else {
+                memset(bytes, 0, length);
+            }
+        }
+
+        template<size_t N>
+        void Read(std::array<uint8_t, N> &bytes) {
+            Read(bytes.data(), N);
+        }
+
+        bool Failed() const { return failed; }
+        size_t Remaining() const { return size - position; }
+
+    private:
+        const uint8_t *data;
+        size_t size;
+        size_t position = 0;
+        bool failed = false;
+
+        bool Available(size_t length) {
+            if(size - position < length) {
+                failed = true;
+                position = size;
+                return false;
+            }
+            return true;
+        }
+};
+
+// Snapshots the CPU, and the PPU, APU and mapper it is connected to.
+// The ROM itself is not part of the state; a state can only be loaded into
+// a console running the same mapper.
+void SaveState(CPU6502state &cpu, std::vector<uint8_t> &data);
+bool LoadState(CPU6502state &cpu, const uint8_t *data, size_t size);
+
+bool SaveStateFile(CPU6502state &cpu, const std::string &filename);
+bool LoadStateFile(CPU6502state &cpu, const std::string &filename);
+
+#endif // SAVESTATE_H_INCLUDED
@@ -0,0 +1,28 @@
+#include "sdl/audio.h"
+
+void audio_callback(void *_apu, Uint8 *_stream, int _length) {
+    Apu *apu = (Apu*) _apu;
+    float *stream = (float*)_stream;
+    size_t length = (size_t)_length/sizeof(float);
+
+    size_t counter = apu->ReadSamples(stream, length);
+    while(counter < length) {
+        stream[counter++] = 0;
+    }
+}
+
+SDL_AudioDeviceID openAudioDevice(Apu *apu) {
+    SDL_AudioSpec desiredSpec;
+
+    desiredSpec.freq = apu->sample_frequency;
+    desiredSpec.format = AUDIO_F32SYS;
+    desiredSpec.channels = 1;
+    desiredSpec.samples = apu->samples_per_callback;
+    desiredSpec.callback = audio_callback;
+    desiredSpec.userdata = apu;
+
+    SDL_AudioDeviceID deviceId = SDL_OpenAudioDevice(NULL, 0, &desiredSpec, NULL, SDL_AUDIO_ALLOW_ANY_CHANGE);
+    SDL_PauseAudioDevice(deviceId, 0);
+
+    return deviceId;
+}
@@ -0,0 +1,14 @@
+#ifndef SDL_AUDIO_H_INCLUDED
+#define SDL_AUDIO_H_INCLUDED
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_audio.h>
+
+#include "apu/apu.h"
+
+void audio_callback(void *, Uint8*, int);
+
+// Opens and starts an SDL audio device that plays the samples generated by apu
+SDL_AudioDeviceID openAudioDevice(Apu *apu);
+
+#endif // SDL_AUDIO_H_INCLUDED
@@ -0,0 +1,52 @@
+#include <stdio.h>
+
+#include "sdl/display.h"
+
+Display::Display(const char *title, int scale, VideoFilter filter) {
+    this->filter = filter;
+    texture_scale = filter != VideoFilter::None ? FilterScale(filter) : 1;
+
+    window = SDL_CreateWindow( title, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 256*scale, 240*scale, SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE );
+    if( window == NULL ) {
+        fprintf(stderr, "Error: Could not create a window: %s\n", SDL_GetError());
+        return;
+    }
+
+    // frames are paced by the emulator, not by vsync
+    renderer = SDL_CreateRenderer( window, -1, SDL_RENDERER_ACCELERATED );
+    if( renderer == NULL ) {
+        fprintf(stderr, "Error: Could not create a renderer: %s\n", SDL_GetError());
+        return;
+    }
+    SDL_RenderSetLogicalSize( renderer, 256, 240 );
+
+    texture = SDL_CreateTexture( renderer, SDL_PIXELFORMAT_RGB888, SDL_TEXTUREACCESS_STREAMING, 256*texture_scale, 240*texture_scale );
+    if( texture == NULL ) {
+        fprintf(stderr, "Error: Could not create a texture: %s\n", SDL_GetError());
+    }
+}
+
+Display::~Display() {
+    if( texture != NULL ) {
+        SDL_DestroyTexture(texture);
+    }
+    if( renderer != NULL ) {
+        SDL_DestroyRenderer(renderer);
+    }
+    if( window != NULL ) {
+        SDL_DestroyWindow(window);
+    }
+}
+
+void Display::Present(const uint8_t *frame) {
+    void *pixels;
+    int pitch;
+    if( SDL_LockTexture(texture, NULL, &pixels, &pitch) == 0 ) {
+        ScaleFrame(frame, (uint32_t*)pixels, pitch/4, texture_scale, filter);
+        SDL_UnlockTexture(texture);
+    }
+
+    SDL_RenderClear(renderer);
+    SDL_RenderCopy(renderer, texture, NULL, NULL);
+    SDL_RenderPresent(renderer);
+}
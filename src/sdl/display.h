@@ -0,0 +1,34 @@
+#ifndef SDL_DISPLAY_H_INCLUDED
+#define SDL_DISPLAY_H_INCLUDED
+
+#include <SDL2/SDL.h>
+
+#include "video.h"
+
+// Window showing the frames of the PPU. Each frame is converted to RGB
+// once into a streaming texture, and the renderer scales that to whatever
+// size the window has, keeping the aspect ratio. With a filter, the
+// texture holds the filtered frame at the filter's scale.
+class Display {
+    public:
+        Display(const char *title, int scale, VideoFilter filter = VideoFilter::None);
+        ~Display();
+
+        Display(const Display&) = delete;
+        Display &operator=(const Display&) = delete;
+
+        bool IsValid() const { return texture != NULL; }
+
+        // Shows a 256x240 frame of palette indices
+        void Present(const uint8_t *frame);
+
+    private:
+        SDL_Window *window = NULL;
+        SDL_Renderer *renderer = NULL;
+        SDL_Texture *texture = NULL;
+
+        VideoFilter filter;
+        uint32_t texture_scale;
+};
+
+#endif // SDL_DISPLAY_H_INCLUDED
@@ -0,0 +1,10 @@
+#ifndef SDL_INPUT_H_INCLUDED
+#define SDL_INPUT_H_INCLUDED
+
+#include <SDL2/SDL.h>
+
+#include "controller.h"
+
+void handleInput(Controller *controller, SDL_Event *e);
+
+#endif // SDL_INPUT_H_INCLUDED
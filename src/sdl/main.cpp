@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_audio.h>
+#include <assert.h>
+#include <memory>
+#include <string.h>
+#include <vector>
+
+#include "console.h"
+#include "filereader.h"
+#include "movie.h"
+#include "romindex.h"
+#include "rewind.h"
+#include "savestate.h"
+#include "sdl/audio.h"
+#include "sdl/display.h"
+#include "sdl/input.h"
+#include "sdl/pacing.h"
+
+// the window starts at this many screen pixels per NES pixel, and can be
+// resized freely
+static const int window_scale = 2;
+
+int main(int argc, char *argv[])
+{
+    const char *rom_file = NULL;
+    int run_ahead = 0;
+    bool fast_forward = false;
+    const char *record_file = NULL;
+    VideoFilter filter = VideoFilter::None;
+
+    for(int i=1; i<argc; ++i) {
+        if( strcmp(argv[i], "--run-ahead") == 0 && i+1 < argc ) {
+            run_ahead = atoi(argv[++i]);
+            if( run_ahead < 0 || run_ahead > 3 ) {
+                printf("Error: --run-ahead takes 0 to 3 frames\n");
+                return 1;
+            }
+        }
+        else if( strcmp(argv[i], "--filter") == 0 && i+1 < argc ) {
+            if( !ParseVideoFilter(argv[++i], filter) ) {
+                printf("Error: --filter takes none, scale2x or scale3x\n");
+                return 1;
+            }
+        }
+        else if( strcmp(argv[i], "--record") == 0 && i+1 < argc ) {
+            record_file = argv[++i];
+        }
+        else if( strcmp(argv[i], "--fast-forward") == 0 ) {
+            fast_forward = true;
+        }
+        else {
+            rom_file = argv[i];
+        }
+    }
+
+    if( rom_file == NULL ) {
+        printf("Error: No .nes-file supplied\n");
+        return 1;
+    }
+
+    std::shared_ptr<Mapper> mapper = read_file(rom_file);
+    if( !mapper ) {
+        return 1;
+    }
+    std::cout << *mapper << std::endl;
+
+    //Initalize SDL
+    SDL_Init( SDL_INIT_VIDEO | SDL_INIT_AUDIO );
+    Display display("NESlig", window_scale, filter);
+    if( !display.IsValid() ) {
+        return 1;
+    }
+
+    std::vector<uint8_t> frame(256*240, 0);
+    FrameBuffer frame_buffer = { frame.data() };
+    Console console(mapper, frame_buffer);
+    CPU6502state &cpu = console.cpu;
+    SDL_AudioDeviceID audio_device = openAudioDevice(&cpu.apu);
+
+    //main loop
+    SDL_Event e;
+    int quit = 0;
+    int paused = 0;
+    int rewinding = 0;
+    int fast_forward_held = 0;
+
+    // NTSC frame rate. The audio queue is kept a little above what the
+    // audio device takes per callback.
+    FramePacer pacer(60.0988);
+    size_t audio_target = cpu.apu.samples_per_callback + 1000;
+
+    // one state per frame, several minutes of history
+    RewindBuffer rewind_buffer(32*1024*1024);
+    std::vector<uint8_t> state;
+    std::vector<uint8_t> run_ahead_state;
+
+    // the input of every emulated frame, for neslig-headless and
+    // neslig-bench to play back
+    Movie movie;
+    uint first_frame = console.ppu.GetCurrentFrame();
+    if( record_file != NULL ) {
+        RomIndexEntry rom;
+        rom.path = rom_file;
+        if( ReadRomEntry(rom) ) {
+            movie.rom_sha1 = rom.sha1;
+        }
+    }
+    while(!quit) {
+
+        //Handle input
+        while( SDL_PollEvent( &e ) != 0 ) {
+            if( e.type == SDL_QUIT ) {
+                quit = 1;
+            }
+            if( e.type == SDL_KEYDOWN ) {
+                if( e.key.keysym.sym == SDLK_PAUSE ) {
+                    paused ^= 1;
+                }
+                if( e.key.keysym.sym == SDLK_BACKSPACE ) {
+                    rewinding = 1;
+                }
+                if( e.key.keysym.sym == SDLK_TAB ) {
+                    fast_forward_held = 1;
+                }
+            }
+            if( e.type == SDL_KEYUP && e.key.keysym.sym == SDLK_BACKSPACE ) {
+                rewinding = 0;
+            }
+            if( e.type == SDL_KEYUP && e.key.keysym.sym == SDLK_TAB ) {
+                fast_forward_held = 0;
+            }
+            handleInput(&console.GetController(0), &e);
+        }
+
+
+        // Fast-forwarding runs without pacing or audio, and only draws a
+        // frame when it is time to show one
+        bool fast_forwarding = fast_forward || fast_forward_held;
+        bool present = !fast_forwarding || pacer.IsDue();
+        bool running_ahead = run_ahead > 0 && !rewinding && !fast_forwarding;
+        cpu.apu.output_enabled = !fast_forwarding;
+        console.ppu.skip_output = !present || running_ahead;
+
+        // Emulate CPU
+        // The CPU will clock both the PPU and the APU
+
+        // Every frame starts by recording its state. When rewinding, the
+        // state from the start of the previous frame is loaded instead, and
+        // that frame is emulated again to redraw it. The PPU's frame count
+        // comes back with the state, so the movie drops every frame from the
+        // loaded one on.
+        if(rewinding) {
+            if(rewind_buffer.Pop(state)) {
+                LoadState(cpu, state.data(), state.size());
+                if(record_file != NULL) {
+                    movie.Truncate(console.ppu.GetCurrentFrame() - first_frame);
+                }
+            }
+        }
+        else {
+            SaveState(cpu, state);
+            rewind_buffer.Push(state);
+        }
+
+        if(record_file != NULL) {
+            movie.Record(console);
+        }
+        console.RunFrame();
+
+        // Run ahead: emulate the next frames with the current input and
+        // show the last of them, then go back to the real state. This hides
+        // frames of input lag the game itself adds.
+        if(running_ahead) {
+            SaveState(cpu, run_ahead_state);
+            cpu.apu.output_enabled = false;
+            for(int i=0; i<run_ahead; ++i) {
+                console.ppu.skip_output = (i+1 < run_ahead);
+                console.RunFrame();
+            }
+            cpu.apu.output_enabled = true;
+            LoadState(cpu, run_ahead_state.data(), run_ahead_state.size());
+        }
+
+        if(fast_forwarding) {
+            if(present) {
+                pacer.Reset();
+                display.Present(frame.data());
+            }
+            continue;
+        }
+
+        // Video is paced by the clock, and the audio rate follows it. If the
+        // audio device ran dry anyway, the next frame is emulated right away.
+        updateAudioRate(cpu.apu, audio_target);
+        if(cpu.apu.QueuedSamples() < cpu.apu.samples_per_callback) {
+            pacer.Reset();
+        }
+        else {
+            pacer.Wait();
+        }
+
+        display.Present(frame.data());
+
+    }
+
+    SDL_CloseAudioDevice(audio_device);
+
+    if( record_file != NULL && !movie.Save(record_file) ) {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,31 @@
+#include <algorithm>
+#include <thread>
+
+#include "sdl/pacing.h"
+
+FramePacer::FramePacer(double frames_per_second) {
+    frame_time = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0/frames_per_second) );
+    Reset();
+}
+
+void FramePacer::Wait() {
+    auto now = std::chrono::steady_clock::now();
+    if(now > next_frame + frame_time) {
+        next_frame = now;
+    }
+    else {
+        std::this_thread::sleep_until(next_frame);
+    }
+    next_frame += frame_time;
+}
+
+void FramePacer::Reset() {
+    next_frame = std::chrono::steady_clock::now() + frame_time;
+}
+
+void updateAudioRate(Apu &apu, size_t target_samples) {
+    double fill = (double)apu.QueuedSamples() / target_samples;
+    double adjustment = std::clamp(1.0 - fill, -1.0, 1.0) * Apu::max_rate_adjustment;
+    apu.SetRateAdjustment(adjustment);
+}
@@ -0,0 +1,32 @@
+#ifndef SDL_PACING_H_INCLUDED
+#define SDL_PACING_H_INCLUDED
+
+#include <chrono>
+
+#include "apu/apu.h"
+
+// Paces frames against a steady clock. Wait() sleeps until the deadline of
+// the next frame instead of measuring each frame on its own, so rounding
+// does not add up. If emulation falls more than a frame behind, the
+// schedule restarts from now instead of rushing to catch up.
+class FramePacer {
+    public:
+        FramePacer(double frames_per_second);
+
+        void Wait();
+        void Reset();
+
+        // True once the deadline of the next frame has passed
+        bool IsDue() const { return std::chrono::steady_clock::now() >= next_frame; }
+
+    private:
+        std::chrono::steady_clock::duration frame_time;
+        std::chrono::steady_clock::time_point next_frame;
+};
+
+// Nudges the APU sample rate so the queued samples stay around
+// target_samples: faster when the queue runs low, slower when it grows.
+// Call once per frame.
+void updateAudioRate(Apu &apu, size_t target_samples);
+
+#endif // SDL_PACING_H_INCLUDED
@@ -0,0 +1,72 @@
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(size_t threads) {
+    for(size_t i=1; i<threads; ++i) {
+        workers.emplace_back(&ThreadPool::Work, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    work_ready.notify_all();
+    for(std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)> &task) {
+    if(workers.empty() || count <= 1) {
+        for(size_t i=0; i<count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        this->task = &task;
+        task_count = count;
+        next_index = 0;
+        busy_workers = workers.size();
+        generation += 1;
+    }
+    work_ready.notify_all();
+
+    RunTasks();
+
+    std::unique_lock<std::mutex> guard(lock);
+    work_done.wait(guard, [this]{ return busy_workers == 0; });
+    this->task = NULL;
+}
+
+void ThreadPool::Work() {
+    uint64_t seen_generation = 0;
+    while(true) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            work_ready.wait(guard, [&]{ return stopping || generation != seen_generation; });
+            if(stopping) {
+                return;
+            }
+            seen_generation = generation;
+        }
+
+        RunTasks();
+
+        std::lock_guard<std::mutex> guard(lock);
+        busy_workers -= 1;
+        if(busy_workers == 0) {
+            work_done.notify_one();
+        }
+    }
+}
+
+void ThreadPool::RunTasks() {
+    size_t index;
+    while( (index = next_index.fetch_add(1)) < task_count ) {
+        (*task)(index);
+    }
+}
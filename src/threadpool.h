@@ -0,0 +1,50 @@
+#ifndef THREADPOOL_H_INCLUDED
+#define THREADPOOL_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for running the same task over many
+// independent items, such as stepping a batch of consoles.
+class ThreadPool {
+    public:
+        // threads counts the calling thread, so 1 creates no workers
+        ThreadPool(size_t threads);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Calls task(i) for every i below count, spread over the workers and
+        // the calling thread. Returns once every call has finished.
+        void ParallelFor(size_t count, const std::function<void(size_t)> &task);
+
+        size_t Size() const { return workers.size() + 1; }
+
+    private:
+        std::vector<std::thread> workers;
+
+        std::mutex lock;
+        std::condition_variable work_ready;
+        std::condition_variable work_done;
+        bool stopping = false;
+
+        // The current ParallelFor() call, guarded by lock apart from
+        // next_index
+        const std::function<void(size_t)> *task = NULL;
+        size_t task_count = 0;
+        uint64_t generation = 0;
+        size_t busy_workers = 0;
+        std::atomic<size_t> next_index = 0;
+
+        void Work();
+        void RunTasks();
+};
+
+#endif // THREADPOOL_H_INCLUDED
@@ -0,0 +1,92 @@
+#include <map>
+#include <mutex>
+
+#include "tilecache.h"
+
+static uint8_t ReverseBits(uint8_t value) {
+    uint8_t reversed = 0;
+    for(int bit=0; bit<8; ++bit) {
+        reversed = (reversed << 1) | (value & 1);
+        value >>= 1;
+    }
+    return reversed;
+}
+
+void TileCache::SetMapper(std::shared_ptr<Mapper> mapper) {
+    this->mapper = mapper;
+    InvalidateAll();
+}
+
+void TileCache::InvalidateAll() {
+    if( !mapper ) {
+        return;
+    }
+    chr_version = mapper->GetChrVersion();
+
+    const uint8_t *chr_rom = mapper->GetChrRom();
+    if( chr_rom != NULL ) {
+        rom_tiles = GetRomTiles(chr_rom);
+        tiles = rom_tiles.get();
+        return;
+    }
+    rom_tiles.reset();
+    if( !ram_tiles ) {
+        ram_tiles = std::make_unique<TileSet>();
+    }
+    ram_tiles->valid.fill(false);
+    tiles = ram_tiles.get();
+}
+
+void TileCache::Decode(uint16_t index) {
+    // only CHR RAM tiles are ever invalid
+    uint8_t pattern[16];
+    for(int i=0; i<16; ++i) {
+        pattern[i] = mapper->ReadChr(index*16 + i);
+    }
+    DecodeTile(pattern, ram_tiles->tiles[index]);
+    ram_tiles->valid[index] = true;
+}
+
+void TileCache::DecodeTile(const uint8_t *pattern, Tile &tile) {
+    for(int i=0; i<16; ++i) {
+        tile.planes[0][i] = pattern[i];
+        tile.planes[1][i] = ReverseBits(pattern[i]);
+    }
+
+    for(int row=0; row<8; ++row) {
+        uint8_t plane_0 = tile.planes[0][row];
+        uint8_t plane_1 = tile.planes[0][row+8];
+        for(int column=0; column<8; ++column) {
+            uint8_t color = (((plane_1 >> (7-column)) & 1) << 1) | ((plane_0 >> (7-column)) & 1);
+            tile.pixels[0][row][column] = color;
+            tile.pixels[1][row][7-column] = color;
+        }
+    }
+}
+
+// Keyed by the address of the bank, which stays valid while any console
+// using it is alive, since their mappers keep the ROM image mapped
+static std::mutex rom_tiles_mutex;
+static std::map< const uint8_t*, std::weak_ptr<const void> > rom_tile_sets;
+
+std::shared_ptr<const TileCache::TileSet> TileCache::GetRomTiles(const uint8_t *chr_rom) {
+    std::lock_guard<std::mutex> lock(rom_tiles_mutex);
+    for(auto it = rom_tile_sets.begin(); it != rom_tile_sets.end(); ) {
+        it = it->second.expired() ? rom_tile_sets.erase(it) : std::next(it);
+    }
+
+    auto it = rom_tile_sets.find(chr_rom);
+    if(it != rom_tile_sets.end()) {
+        if(std::shared_ptr<const void> tile_set = it->second.lock()) {
+            return std::static_pointer_cast<const TileSet>(tile_set);
+        }
+    }
+
+    std::shared_ptr<TileSet> tile_set = std::make_shared<TileSet>();
+    for(int index=0; index<512; ++index) {
+        DecodeTile(chr_rom + index*16, tile_set->tiles[index]);
+    }
+    tile_set->valid.fill(true);
+    rom_tile_sets[chr_rom] = tile_set;
+    return tile_set;
+}
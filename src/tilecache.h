@@ -0,0 +1,80 @@
+#ifndef TILECACHE_H_INCLUDED
+#define TILECACHE_H_INCLUDED
+
+#include <stdint.h>
+#include <array>
+#include <memory>
+
+#include "mappers/mapper.h"
+
+// Decoded copy of the 512 tiles of the CHR memory the PPU sees at
+// $0000-$1FFF. Each tile row is kept as its two raw bitplanes and as
+// 8 color indices (0-3) per pixel, both also mirrored horizontally, so
+// renderers neither go through the mapper nor shift bitplanes apart.
+//
+// CHR ROM banks are decoded once per process and shared by every console
+// showing the same bank. CHR RAM gets a copy of its own, whose tiles are
+// decoded on first use. Writes to CHR memory through the PPU have to be
+// passed to Invalidate(), everything else that changes what the mapper
+// returns bumps its CHR version, which invalidates all tiles.
+class TileCache {
+    public:
+        void SetMapper(std::shared_ptr<Mapper> mapper);
+
+        // The 8 pixels of the tile row whose low bitplane is at address
+        const uint8_t *GetPixels(uint16_t address, bool flip_x) {
+            return GetTile(address).pixels[flip_x][address & 7];
+        }
+
+        // The pattern byte at address, bits reversed if flip_x is set
+        uint8_t GetPattern(uint16_t address, bool flip_x = false) {
+            return GetTile(address).planes[flip_x][address & 15];
+        }
+
+        void Invalidate(uint16_t address) {
+            if( ram_tiles ) {
+                ram_tiles->valid[(address >> 4) & 0x1FF] = false;
+            }
+        }
+
+        void InvalidateAll();
+
+    private:
+        struct Tile {
+            uint8_t pixels[2][8][8];
+            uint8_t planes[2][16];
+        };
+
+        struct TileSet {
+            std::array<Tile, 512> tiles;
+            std::array<bool, 512> valid = {};
+        };
+
+        // The set in use, one of the two below
+        const TileSet *tiles = NULL;
+        std::shared_ptr<const TileSet> rom_tiles;
+        std::unique_ptr<TileSet> ram_tiles;
+
+        std::shared_ptr<Mapper> mapper;
+        uint32_t chr_version = 0;
+
+        const Tile &GetTile(uint16_t address) {
+            if( mapper->GetChrVersion() != chr_version ) {
+                InvalidateAll();
+            }
+            uint16_t index = (address >> 4) & 0x1FF;
+            if( !tiles->valid[index] ) {
+                Decode(index);
+            }
+            return tiles->tiles[index];
+        }
+
+        void Decode(uint16_t index);
+
+        // The decoded tiles of an 8 KB CHR ROM bank, shared with every
+        // other cache using the same bank
+        static std::shared_ptr<const TileSet> GetRomTiles(const uint8_t *chr_rom);
+        static void DecodeTile(const uint8_t *pattern, Tile &tile);
+};
+
+#endif // TILECACHE_H_INCLUDED
@@ -0,0 +1,428 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "console.h"
+#include "hash.h"
+#include "movie.h"
+#include "savestate.h"
+
+// Measures uncapped emulation throughput for one or more ROMs.
+// Every run emulates a fixed number of frames from power-on without any
+// input, so results from different builds are directly comparable.
+// With --instances, several consoles run the same ROM on their own threads
+// and the reported rates are the totals over all of them.
+// With --movie, every console plays back the same recorded input instead.
+// The time of every frame and the CRC-32 of the final state are reported
+// too, so builds that emulate differently stand out. Final states are only
+// compared with a baseline that ran the same frames and movie.
+
+struct BenchResult {
+    std::string rom;
+    double seconds = 0;
+    double frames_per_second = 0;
+    double instructions_per_second = 0;
+    double ppu_dots_per_second = 0;
+    double apu_samples_per_second = 0;
+    // of the first console
+    double frame_ms_median = 0;
+    double frame_ms_p99 = 0;
+    double frame_ms_max = 0;
+    std::string state_crc32;
+    // the workload behind state_crc32, movie_sha1 is empty without a movie
+    uint32_t frames = 0;
+    std::string movie_sha1;
+};
+
+static void printUsage(const char *program) {
+    printf("Usage: %s [options] <iNES file>...\n", program);
+    printf("  -n <frames>         frames to emulate per run (default 3000)\n");
+    printf("  -r <runs>           runs per ROM, the fastest one is reported (default 3)\n");
+    printf("  --instances <n>     consoles emulated concurrently per run (default 1)\n");
+    printf("  --json <file>       write the results as JSON\n");
+    printf("  --baseline <file>   compare against results saved with --json\n");
+    printf("  --threshold <pct>   exit with status 2 if frames/sec drops more than pct\n");
+    printf("                      below the baseline (default 5)\n");
+    printf("  --movie <file>      play back controller input from a movie (.fm2 is\n");
+    printf("                      imported), -n defaults to its length\n");
+    printf("Exits with status 3 if a final state differs from a baseline that ran the\n");
+    printf("same frames and movie.\n");
+}
+
+struct InstanceCounts {
+    uint64_t instructions = 0;
+    uint64_t samples = 0;
+    uint64_t cycles = 0;
+    std::vector<double> frame_ms;
+};
+
+static void emulateFrames(Console &console, uint32_t frames, const Movie *movie, InstanceCounts &counts) {
+    float samples[1024];
+    uint64_t cycles_before = console.cpu.GetClockCycles();
+    counts.frame_ms.reserve(frames);
+
+    for(uint32_t frame=0; frame<frames; ++frame) {
+        auto frame_start = std::chrono::steady_clock::now();
+        if( movie != NULL ) {
+            movie->Apply(frame, console);
+        }
+        counts.instructions += console.RunFrame();
+
+        size_t read = 0;
+        while( (read = console.cpu.apu.ReadSamples(samples, 1024)) > 0 ) {
+            counts.samples += read;
+        }
+        counts.frame_ms.push_back( std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frame_start).count() );
+    }
+    counts.cycles = console.cpu.GetClockCycles() - cycles_before;
+}
+
+// Hashes the input rather than the file, so an imported .fm2 matches the
+// movie it was saved as
+static std::string movieSha1(const Movie &movie) {
+    Sha1 sha1;
+    for(size_t frame=0; frame<movie.Size(); ++frame) {
+        for(int port=0; port<Movie::ports; ++port) {
+            uint8_t buttons = movie.GetButtons(frame, port);
+            sha1.Update(&buttons, 1);
+        }
+    }
+    Sha1Digest digest = sha1.Final();
+    return ToHex(digest.data(), digest.size());
+}
+
+static bool runBenchmark(const std::string &rom, uint32_t frames, uint32_t instances, const Movie *movie, BenchResult &result) {
+    std::vector< std::vector<uint8_t> > frame_buffers(instances, std::vector<uint8_t>(256*240, 0));
+    std::vector< std::unique_ptr<Console> > consoles;
+    for(uint32_t i=0; i<instances; ++i) {
+        FrameBuffer frame_buffer = { frame_buffers[i].data() };
+        consoles.push_back( Console::FromFile(rom, frame_buffer) );
+        if( !consoles.back() ) {
+            return false;
+        }
+    }
+
+    std::vector<InstanceCounts> counts(instances);
+
+    auto start = std::chrono::steady_clock::now();
+    if( instances == 1 ) {
+        emulateFrames(*consoles[0], frames, movie, counts[0]);
+    }
+    else {
+        std::vector<std::thread> threads;
+        for(uint32_t i=0; i<instances; ++i) {
+            threads.emplace_back(emulateFrames, std::ref(*consoles[i]), frames, movie, std::ref(counts[i]));
+        }
+        for(std::thread &thread : threads) {
+            thread.join();
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    uint64_t instructions = 0;
+    uint64_t sample_count = 0;
+    uint64_t ppu_dots = 0;
+    for(const InstanceCounts &count : counts) {
+        instructions += count.instructions;
+        sample_count += count.samples;
+        // The PPU runs exactly three dots per CPU cycle
+        ppu_dots += 3*count.cycles;
+    }
+
+    result.rom = rom;
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    result.frames_per_second = (double)frames*instances / result.seconds;
+    result.instructions_per_second = instructions / result.seconds;
+    result.ppu_dots_per_second = ppu_dots / result.seconds;
+    result.apu_samples_per_second = sample_count / result.seconds;
+
+    std::vector<double> &frame_ms = counts[0].frame_ms;
+    std::sort(frame_ms.begin(), frame_ms.end());
+    result.frame_ms_median = frame_ms[frame_ms.size()/2];
+    result.frame_ms_p99 = frame_ms[frame_ms.size()*99/100];
+    result.frame_ms_max = frame_ms.back();
+
+    std::vector<uint8_t> state;
+    SaveState(consoles[0]->cpu, state);
+    char crc[9];
+    snprintf(crc, sizeof(crc), "%08x", Crc32(state.data(), state.size()));
+    result.state_crc32 = crc;
+    result.frames = frames;
+    result.movie_sha1 = movie != NULL ? movieSha1(*movie) : "";
+    return true;
+}
+
+static std::string escapeJSON(const std::string &text) {
+    std::string escaped;
+    for(char c : text) {
+        if( c == '"' || c == '\\' ) {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+static bool writeJSON(const std::string &filename, uint32_t frames, uint32_t runs, uint32_t instances, const std::vector<BenchResult> &results) {
+    std::ofstream out(filename);
+    if( !out ) {
+        return false;
+    }
+    out.precision(10);
+    out << "{\n";
+    out << "  \"frames\": " << frames << ",\n";
+    out << "  \"runs\": " << runs << ",\n";
+    out << "  \"instances\": " << instances << ",\n";
+    out << "  \"results\": [\n";
+    for(size_t i=0; i<results.size(); ++i) {
+        const BenchResult &result = results[i];
+        out << "    {\n";
+        out << "      \"rom\": \"" << escapeJSON(result.rom) << "\",\n";
+        out << "      \"seconds\": " << result.seconds << ",\n";
+        out << "      \"frames_per_second\": " << result.frames_per_second << ",\n";
+        out << "      \"instructions_per_second\": " << result.instructions_per_second << ",\n";
+        out << "      \"ppu_dots_per_second\": " << result.ppu_dots_per_second << ",\n";
+        out << "      \"apu_samples_per_second\": " << result.apu_samples_per_second << ",\n";
+        out << "      \"frame_ms_median\": " << result.frame_ms_median << ",\n";
+        out << "      \"frame_ms_p99\": " << result.frame_ms_p99 << ",\n";
+        out << "      \"frame_ms_max\": " << result.frame_ms_max << ",\n";
+        out << "      \"state_crc32\": \"" << result.state_crc32 << "\",\n";
+        out << "      \"frames\": " << result.frames << ",\n";
+        out << "      \"movie_sha1\": \"" << result.movie_sha1 << "\"\n";
+        out << "    }" << (i+1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+    return (bool)out;
+}
+
+// Reads back the "results" written by writeJSON. This is not a general JSON
+// parser, it only understands flat objects with string and number values.
+static bool readBaseline(const std::string &filename, std::map<std::string, BenchResult> &baseline) {
+    std::ifstream in(filename);
+    if( !in ) {
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    std::string text = buffer.str();
+
+    size_t position = text.find("\"results\"");
+    if( position == std::string::npos ) {
+        return false;
+    }
+
+    while( (position = text.find('{', position)) != std::string::npos ) {
+        size_t object_end = text.find('}', position);
+        if( object_end == std::string::npos ) {
+            return false;
+        }
+
+        std::map<std::string, std::string> values;
+        size_t key_start = position;
+        while( (key_start = text.find('"', key_start)) != std::string::npos && key_start < object_end ) {
+            size_t key_end = text.find('"', key_start+1);
+            size_t colon = text.find(':', key_end);
+            if( key_end == std::string::npos || colon == std::string::npos || colon > object_end ) {
+                break;
+            }
+            std::string key = text.substr(key_start+1, key_end-key_start-1);
+
+            size_t value_start = text.find_first_not_of(" \t\r\n", colon+1);
+            size_t value_end;
+            std::string value;
+            if( text[value_start] == '"' ) {
+                value_end = value_start+1;
+                while( value_end < object_end && text[value_end] != '"' ) {
+                    if( text[value_end] == '\\' ) {
+                        ++value_end;
+                    }
+                    value += text[value_end++];
+                }
+                ++value_end;
+            }
+            else {
+                value_end = text.find_first_of(",}\r\n", value_start);
+                value = text.substr(value_start, value_end-value_start);
+            }
+            values[key] = value;
+            key_start = value_end;
+        }
+
+        BenchResult result;
+        result.rom = values["rom"];
+        result.seconds = atof(values["seconds"].c_str());
+        result.frames_per_second = atof(values["frames_per_second"].c_str());
+        result.instructions_per_second = atof(values["instructions_per_second"].c_str());
+        result.ppu_dots_per_second = atof(values["ppu_dots_per_second"].c_str());
+        result.apu_samples_per_second = atof(values["apu_samples_per_second"].c_str());
+        result.frame_ms_median = atof(values["frame_ms_median"].c_str());
+        result.frame_ms_p99 = atof(values["frame_ms_p99"].c_str());
+        result.frame_ms_max = atof(values["frame_ms_max"].c_str());
+        result.state_crc32 = values["state_crc32"];
+        result.frames = strtoul(values["frames"].c_str(), NULL, 10);
+        result.movie_sha1 = values["movie_sha1"];
+        baseline[result.rom] = result;
+
+        position = object_end;
+    }
+    return true;
+}
+
+static double percentChange(double value, double baseline) {
+    if( baseline == 0 ) {
+        return 0;
+    }
+    return 100.0*(value-baseline)/baseline;
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::string> roms;
+    const char *json_file = NULL;
+    const char *baseline_file = NULL;
+    const char *movie_file = NULL;
+    uint32_t frames = 3000;
+    bool frames_given = false;
+    uint32_t runs = 3;
+    uint32_t instances = 1;
+    double threshold = 5.0;
+
+    for(int i=1; i<argc; ++i) {
+        if( strcmp(argv[i], "-n") == 0 && i+1 < argc ) {
+            frames = strtoul(argv[++i], NULL, 10);
+            frames_given = true;
+        }
+        else if( strcmp(argv[i], "-r") == 0 && i+1 < argc ) {
+            runs = strtoul(argv[++i], NULL, 10);
+        }
+        else if( strcmp(argv[i], "--instances") == 0 && i+1 < argc ) {
+            instances = strtoul(argv[++i], NULL, 10);
+        }
+        else if( strcmp(argv[i], "--json") == 0 && i+1 < argc ) {
+            json_file = argv[++i];
+        }
+        else if( strcmp(argv[i], "--baseline") == 0 && i+1 < argc ) {
+            baseline_file = argv[++i];
+        }
+        else if( strcmp(argv[i], "--threshold") == 0 && i+1 < argc ) {
+            threshold = atof(argv[++i]);
+        }
+        else if( strcmp(argv[i], "--movie") == 0 && i+1 < argc ) {
+            movie_file = argv[++i];
+        }
+        else if( argv[i][0] == '-' ) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        else {
+            roms.push_back(argv[i]);
+        }
+    }
+
+    Movie movie;
+    if( movie_file != NULL ) {
+        if( !movie.LoadAny(movie_file) ) {
+            return 1;
+        }
+        if( !frames_given ) {
+            frames = movie.Size();
+        }
+    }
+
+    if( roms.empty() || frames == 0 || runs == 0 || instances == 0 ) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::vector<BenchResult> results;
+    for(const std::string &rom : roms) {
+        BenchResult best;
+        for(uint32_t run=0; run<runs; ++run) {
+            BenchResult result;
+            if( !runBenchmark(rom, frames, instances, movie_file != NULL ? &movie : NULL, result) ) {
+                fprintf(stderr, "Error: Could not benchmark %s\n", rom.c_str());
+                return 1;
+            }
+            if( run == 0 || result.seconds < best.seconds ) {
+                best = result;
+            }
+        }
+        results.push_back(best);
+    }
+
+    printf("\n%-32s %10s %14s %14s %14s\n", "ROM", "frames/s", "instr/s", "PPU dots/s", "APU samples/s");
+    for(const BenchResult &result : results) {
+        printf("%-32s %10.1f %14.0f %14.0f %14.0f\n", result.rom.c_str(), result.frames_per_second,
+               result.instructions_per_second, result.ppu_dots_per_second, result.apu_samples_per_second);
+    }
+
+    printf("\n%-32s %10s %10s %10s %10s\n", "ROM", "median ms", "p99 ms", "max ms", "state");
+    for(const BenchResult &result : results) {
+        printf("%-32s %10.3f %10.3f %10.3f %10s\n", result.rom.c_str(), result.frame_ms_median,
+               result.frame_ms_p99, result.frame_ms_max, result.state_crc32.c_str());
+    }
+
+    if( json_file != NULL && !writeJSON(json_file, frames, runs, instances, results) ) {
+        fprintf(stderr, "Error: Could not write %s\n", json_file);
+        return 1;
+    }
+
+    int status = 0;
+    if( baseline_file != NULL ) {
+        std::map<std::string, BenchResult> baseline;
+        bool regressed = false;
+        bool differs = false;
+        if( !readBaseline(baseline_file, baseline) ) {
+            fprintf(stderr, "Error: Could not read baseline %s\n", baseline_file);
+            return 1;
+        }
+
+        printf("\nCompared to %s:\n", baseline_file);
+        for(const BenchResult &result : results) {
+            auto it = baseline.find(result.rom);
+            if( it == baseline.end() ) {
+                printf("%-32s not in baseline\n", result.rom.c_str());
+                continue;
+            }
+            const BenchResult &base = it->second;
+            double change = percentChange(result.frames_per_second, base.frames_per_second);
+            printf("%-32s %+9.1f%% %+13.1f%% %+13.1f%% %+13.1f%%\n", result.rom.c_str(), change,
+                   percentChange(result.instructions_per_second, base.instructions_per_second),
+                   percentChange(result.ppu_dots_per_second, base.ppu_dots_per_second),
+                   percentChange(result.apu_samples_per_second, base.apu_samples_per_second));
+            if( change < -threshold ) {
+                regressed = true;
+            }
+            if( base.state_crc32.empty() ) {
+                continue;
+            }
+            if( base.frames != result.frames || base.movie_sha1 != result.movie_sha1 ) {
+                printf("%-32s final state not compared, the baseline ran other frames or input\n", result.rom.c_str());
+            }
+            else if( base.state_crc32 != result.state_crc32 ) {
+                printf("%-32s final state %s differs from %s\n", result.rom.c_str(), result.state_crc32.c_str(), base.state_crc32.c_str());
+                differs = true;
+            }
+        }
+        if( regressed ) {
+            printf("\nRegression of more than %.1f%% detected\n", threshold);
+            status = 2;
+        }
+        if( differs ) {
+            printf("\nEmulation differs from the baseline\n");
+            status = 3;
+        }
+    }
+
+    return status;
+}
@@ -0,0 +1,285 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "console.h"
+#include "movie.h"
+#include "romindex.h"
+#include "savestate.h"
+#include "video.h"
+
+// Runs a ROM for a fixed number of frames without a window or audio device.
+// Video and audio are written into buffers owned by this runner, and can
+// optionally be dumped to files afterwards.
+
+static void printUsage(const char *program) {
+    printf("Usage: %s [options] <iNES file>\n", program);
+    printf("  -n <frames>       number of frames to emulate (default 600, or the\n");
+    printf("                    length of the movie)\n");
+    printf("  --video <file>    write the last frame as a binary PPM image\n");
+    printf("  --scale <1-6>     scale the PPM image by this factor (default 1)\n");
+    printf("  --filter <name>   scale the PPM image with scale2x or scale3x\n");
+    printf("  --audio <file>    write all samples as raw 32-bit float mono, 44100 Hz\n");
+    printf("  --trace <file>    log every executed instruction in nestest.log format\n");
+    printf("  --load-state <file>  start from a save state instead of power-on\n");
+    printf("  --save-state <file>  write a save state after the last frame\n");
+    printf("  --movie <file>    play back controller input from a movie (.fm2 is\n");
+    printf("                    imported), and print the CRC-32 of the final state\n");
+    printf("  --record <file>   write the controller input of every frame as a movie\n");
+    printf("  --check-sync      emulate with the PPU and APU caught up lazily and\n");
+    printf("                    stepped every cycle, exit with status 2 if they differ\n");
+}
+
+static bool writePPM(const std::string &filename, const std::vector<uint8_t> &frame, uint32_t scale, VideoFilter filter) {
+    uint32_t width = 256*scale;
+    uint32_t height = 240*scale;
+    std::vector<uint32_t> pixels(width*height);
+    if( !ScaleFrame(frame.data(), pixels.data(), width, scale, filter) ) {
+        return false;
+    }
+
+    std::ofstream out(filename, std::ios_base::binary);
+    if(!out) {
+        return false;
+    }
+    out << "P6\n" << width << " " << height << "\n255\n";
+    for(uint32_t color : pixels) {
+        char rgb[3] = { (char)((color >> 16) & 0xFF), (char)((color >> 8) & 0xFF), (char)(color & 0xFF) };
+        out.write(rgb, 3);
+    }
+    return (bool)out;
+}
+
+// Lazy catch-up must not change what the CPU sees, such as the cycle an NMI
+// arrives at. Runs the ROM both ways and compares the CPUs and pictures
+// after every frame.
+static int checkSync(const char *rom_file, uint32_t frames, const Movie *movie) {
+    std::vector<uint8_t> pictures[2] = { std::vector<uint8_t>(256*240, 0), std::vector<uint8_t>(256*240, 0) };
+    std::unique_ptr<Console> consoles[2];
+    for(int i=0; i<2; ++i) {
+        FrameBuffer frame_buffer = { pictures[i].data() };
+        consoles[i] = Console::FromFile(rom_file, frame_buffer);
+        if( !consoles[i] ) {
+            return 1;
+        }
+        consoles[i]->cpu.apu.output_enabled = false;
+    }
+    consoles[1]->cpu.catch_up_ppu = false;
+    consoles[1]->cpu.catch_up_apu = false;
+
+    for(uint32_t frame=0; frame<frames; ++frame) {
+        for(std::unique_ptr<Console> &console : consoles) {
+            if( movie != NULL ) {
+                movie->Apply(frame, *console);
+            }
+            console->RunFrame();
+        }
+
+        const CPU6502state &lazy = consoles[0]->cpu;
+        const CPU6502state &stepped = consoles[1]->cpu;
+        const char *difference = NULL;
+        if( lazy.PC != stepped.PC || lazy.SP != stepped.SP || lazy.A != stepped.A ||
+            lazy.X != stepped.X || lazy.Y != stepped.Y || lazy.P != stepped.P ) {
+            difference = "CPU registers";
+        }
+        else if( consoles[0]->cpu.GetClockCycles() != consoles[1]->cpu.GetClockCycles() ) {
+            difference = "CPU cycles";
+        }
+        else if( lazy.ram != stepped.ram ) {
+            difference = "RAM";
+        }
+        else if( pictures[0] != pictures[1] ) {
+            difference = "picture";
+        }
+        if( difference != NULL ) {
+            printf("Catch-up and per-cycle emulation differ in %s after frame %u\n", difference, frame);
+            return 2;
+        }
+    }
+
+    printf("Catch-up and per-cycle emulation agree for %u frames\n", frames);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *rom_file = NULL;
+    const char *video_file = NULL;
+    const char *audio_file = NULL;
+    const char *trace_file = NULL;
+    const char *load_state_file = NULL;
+    const char *save_state_file = NULL;
+    const char *movie_file = NULL;
+    const char *record_file = NULL;
+    uint32_t frames = 600;
+    bool frames_given = false;
+    bool check_sync = false;
+    uint32_t scale = 1;
+    VideoFilter filter = VideoFilter::None;
+
+    for(int i=1; i<argc; ++i) {
+        if( strcmp(argv[i], "-n") == 0 && i+1 < argc ) {
+            frames = strtoul(argv[++i], NULL, 10);
+            frames_given = true;
+        }
+        else if( strcmp(argv[i], "--video") == 0 && i+1 < argc ) {
+            video_file = argv[++i];
+        }
+        else if( strcmp(argv[i], "--scale") == 0 && i+1 < argc ) {
+            scale = strtoul(argv[++i], NULL, 10);
+        }
+        else if( strcmp(argv[i], "--filter") == 0 && i+1 < argc ) {
+            if( !ParseVideoFilter(argv[++i], filter) ) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        else if( strcmp(argv[i], "--audio") == 0 && i+1 < argc ) {
+            audio_file = argv[++i];
+        }
+        else if( strcmp(argv[i], "--trace") == 0 && i+1 < argc ) {
+            trace_file = argv[++i];
+        }
+        else if( strcmp(argv[i], "--load-state") == 0 && i+1 < argc ) {
+            load_state_file = argv[++i];
+        }
+        else if( strcmp(argv[i], "--save-state") == 0 && i+1 < argc ) {
+            save_state_file = argv[++i];
+        }
+        else if( strcmp(argv[i], "--movie") == 0 && i+1 < argc ) {
+            movie_file = argv[++i];
+        }
+        else if( strcmp(argv[i], "--record") == 0 && i+1 < argc ) {
+            record_file = argv[++i];
+        }
+        else if( strcmp(argv[i], "--check-sync") == 0 ) {
+            check_sync = true;
+        }
+        else if( argv[i][0] == '-' ) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        else {
+            rom_file = argv[i];
+        }
+    }
+
+    if( rom_file == NULL ) {
+        printf("Error: No .nes-file supplied\n");
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // a filter implies its own scale
+    if( filter != VideoFilter::None ) {
+        scale = FilterScale(filter);
+    }
+    if( scale < 1 || scale > max_video_scale ) {
+        printf("Error: --scale takes 1 to %u\n", max_video_scale);
+        return 1;
+    }
+
+    // a movie made for another ROM still plays, it just will not do what
+    // it was recorded doing
+    Movie movie;
+    RomIndexEntry rom;
+    rom.path = rom_file;
+    bool rom_hashed = (movie_file != NULL || record_file != NULL) && ReadRomEntry(rom);
+    if( movie_file != NULL ) {
+        if( !movie.LoadAny(movie_file) ) {
+            return 1;
+        }
+        if( !frames_given ) {
+            frames = movie.Size();
+        }
+        if( rom_hashed && movie.rom_sha1 != Sha1Digest() && movie.rom_sha1 != rom.sha1 ) {
+            fprintf(stderr, "Warning: %s was recorded with another ROM\n", movie_file);
+        }
+    }
+    if( check_sync ) {
+        return checkSync(rom_file, frames, movie_file != NULL ? &movie : NULL);
+    }
+
+    Movie recording;
+    recording.rom_sha1 = rom.sha1;
+
+    std::vector<uint8_t> frame(256*240, 0);
+    std::vector<float> samples;
+    samples.reserve( (size_t)frames * 800 );
+
+    FrameBuffer frame_buffer = { frame.data() };
+    std::unique_ptr<Console> console = Console::FromFile(rom_file, frame_buffer);
+    if( !console ) {
+        return 1;
+    }
+    CPU6502state &cpu = console->cpu;
+
+    if( load_state_file != NULL && !LoadStateFile(cpu, load_state_file) ) {
+        return 1;
+    }
+
+    if( trace_file != NULL ) {
+        cpu.trace_file = fopen(trace_file, "w");
+        if( cpu.trace_file == NULL ) {
+            fprintf(stderr, "Error: Could not write %s\n", trace_file);
+            return 1;
+        }
+    }
+
+    float chunk[1024];
+    for(uint32_t frame=0; frame<frames; ++frame) {
+        // only the last frame is ever written out
+        console->ppu.skip_output = (frame+1 < frames);
+        if( movie_file != NULL ) {
+            movie.Apply(frame, *console);
+        }
+        recording.Record(*console);
+        console->RunFrame();
+
+        size_t read = 0;
+        while( (read = cpu.apu.ReadSamples(chunk, 1024)) > 0 ) {
+            samples.insert(samples.end(), chunk, chunk+read);
+        }
+    }
+
+    if( cpu.trace_file != NULL ) {
+        fclose(cpu.trace_file);
+        cpu.trace_file = NULL;
+    }
+
+    if( save_state_file != NULL && !SaveStateFile(cpu, save_state_file) ) {
+        return 1;
+    }
+
+    printf("Emulated %u frames, generated %zu audio samples\n", frames, samples.size());
+
+    if( movie_file != NULL ) {
+        std::vector<uint8_t> state;
+        SaveState(cpu, state);
+        printf("Final state CRC-32: %08x\n", Crc32(state.data(), state.size()));
+    }
+
+    if( record_file != NULL && !recording.Save(record_file) ) {
+        return 1;
+    }
+
+    if( video_file != NULL && !writePPM(video_file, frame, scale, filter) ) {
+        fprintf(stderr, "Error: Could not write %s\n", video_file);
+        return 1;
+    }
+
+    if( audio_file != NULL ) {
+        std::ofstream out(audio_file, std::ios_base::binary);
+        out.write((const char*)samples.data(), samples.size()*sizeof(float));
+        if( !out ) {
+            fprintf(stderr, "Error: Could not write %s\n", audio_file);
+            return 1;
+        }
+    }
+
+    return 0;
+}
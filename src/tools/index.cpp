@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <filesystem>
+#include <string>
+
+#include "romindex.h"
+
+// Builds or updates an index of the ROMs below a directory, and looks ROMs
+// up in it by hash. Only files that changed since the index was last
+// written are read again.
+
+static void printUsage(const char *program) {
+    printf("Usage: %s [options] [directory]\n", program);
+    printf("  -o <file>         index file to update (default neslig.index)\n");
+    printf("  -j <threads>      threads to hash ROMs on (default: all cores)\n");
+    printf("  --list            print every ROM in the index\n");
+    printf("  --supported       only print ROMs whose mapper is supported\n");
+    printf("  --find <hash>     print the ROM with this CRC-32 or SHA-1, in hex\n");
+}
+
+static const char *mirroringName(Mirroring mirroring) {
+    switch(mirroring) {
+        case Mirroring::Horizontal: return "horizontal";
+        case Mirroring::Vertical: return "vertical";
+        case Mirroring::SingleScreenLow:
+        case Mirroring::SingleScreenHigh: return "single";
+        case Mirroring::FourScreen: return "four-screen";
+    }
+    return "unknown";
+}
+
+static void printEntry(const RomIndexEntry &entry) {
+    const RomHeader &header = entry.header;
+    printf("%08x %s mapper %3u %5lluK PRG %5lluK CHR %-11s %s%s%s\n",
+        entry.crc32, ToHex(entry.sha1.data(), entry.sha1.size()).c_str(), header.mapper,
+        (unsigned long long)(header.prg_rom_size / 1024), (unsigned long long)(header.chr_rom_size / 1024),
+        mirroringName(header.mirroring), header.battery ? "battery " : "",
+        IsMapperSupported(header) ? "" : "(unsupported) ", entry.path.c_str());
+}
+
+int main(int argc, char *argv[])
+{
+    const char *directory = NULL;
+    const char *index_file = "neslig.index";
+    const char *find = NULL;
+    size_t threads = 0;
+    bool list = false;
+    bool supported_only = false;
+
+    for(int i=1; i<argc; ++i) {
+        if( strcmp(argv[i], "-o") == 0 && i+1 < argc ) {
+            index_file = argv[++i];
+        }
+        else if( strcmp(argv[i], "-j") == 0 && i+1 < argc ) {
+            threads = strtoul(argv[++i], NULL, 10);
+        }
+        else if( strcmp(argv[i], "--list") == 0 ) {
+            list = true;
+        }
+        else if( strcmp(argv[i], "--supported") == 0 ) {
+            list = true;
+            supported_only = true;
+        }
+        else if( strcmp(argv[i], "--find") == 0 && i+1 < argc ) {
+            find = argv[++i];
+        }
+        else if( argv[i][0] == '-' ) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        else {
+            directory = argv[i];
+        }
+    }
+
+    if( directory == NULL && !list && find == NULL ) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    RomIndex index;
+    bool index_exists = std::filesystem::exists(index_file);
+    if( index_exists && !index.Load(index_file) && directory == NULL ) {
+        return 1;
+    }
+    if( !index_exists && directory == NULL ) {
+        fprintf(stderr, "Error: No index %s, give a directory to scan\n", index_file);
+        return 1;
+    }
+
+    if( directory != NULL ) {
+        auto start = std::chrono::steady_clock::now();
+        size_t read = index.Scan(directory, threads);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if( !index.Save(index_file) ) {
+            return 1;
+        }
+        printf("Indexed %zu ROMs, read %zu changed files in %.2f s\n", index.Entries().size(), read, seconds);
+    }
+
+    if( list ) {
+        for(const RomIndexEntry &entry : index.Entries()) {
+            if( !supported_only || IsMapperSupported(entry.header) ) {
+                printEntry(entry);
+            }
+        }
+    }
+
+    if( find != NULL ) {
+        uint8_t crc[4];
+        Sha1Digest sha1;
+        const RomIndexEntry *entry = NULL;
+        if( ParseHex(find, crc, sizeof(crc)) ) {
+            entry = index.FindByCrc32( ((uint32_t)crc[0] << 24) | (crc[1] << 16) | (crc[2] << 8) | crc[3] );
+        }
+        else if( ParseHex(find, sha1.data(), sha1.size()) ) {
+            entry = index.FindBySha1(sha1);
+        }
+        else {
+            fprintf(stderr, "Error: --find takes 8 or 40 hex digits\n");
+            return 1;
+        }
+        if( entry == NULL ) {
+            printf("Not found\n");
+            return 2;
+        }
+        printEntry(*entry);
+    }
+
+    return 0;
+}
@@ -0,0 +1,303 @@
+#include <string.h>
+
+#include "video.h"
+
+// The SSE2 and AVX2 kernels are compiled with target attributes, so the
+// rest of the build does not need to assume either instruction set. The
+// one to use is picked at runtime.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NESLIG_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+const uint32_t ppu_colors[64] =
+{
+0x757575, 0x271B8F, 0x0000AB, 0x47009F, 0x8F0077, 0xAB0013, 0xA70000, 0x7F0B00, 0x432F00, 0x004700, 0x005100, 0x003F17, 0x1B3F5F, 0x000000, 0x000000, 0x000000,
+0xBCBCBC, 0x0073EF, 0x233BEF, 0x8300F3, 0xBF00BF, 0xE7005B, 0xDB2B00, 0xCB4F0F, 0x8B7300, 0x009700, 0x00AB00, 0x00933B, 0x00838B, 0x000000, 0x000000, 0x000000,
+0xFFFFFF, 0x3FBFFF, 0x5F97FF, 0xA78BFD, 0xF77BFF, 0xFF77B7, 0xFF7763, 0xFF9B3B, 0xF3BF3F, 0x83D313, 0x4FDF4B, 0x58F898, 0x00EBDB, 0x000000, 0x000000, 0x000000,
+0xFFFFFF, 0xABE7FF, 0xC7D7FF, 0xD7CBFF, 0xFFC7FF, 0xFFC7DB, 0xFFBFB3, 0xFFDBAB, 0xFFE7A3, 0xE3FFA3, 0xABF3BF, 0xB3FFCF, 0x9FFFF3, 0x000000, 0x000000, 0x000000
+};
+
+/******************
+* row kernels
+******************/
+
+// Every kernel handles one 256 pixel row. convert looks up the colors of
+// the palette indices, widen repeats every color scale (2 or more) times.
+struct VideoKernels {
+    const char *name;
+    void (*convert)(const uint8_t *indices, uint32_t *colors);
+    void (*widen)(const uint32_t *colors, uint32_t *pixels, uint32_t scale);
+};
+
+static void convertRowScalar(const uint8_t *indices, uint32_t *colors) {
+    for(int x=0; x<256; ++x) {
+        colors[x] = ppu_colors[indices[x] & 0x3F];
+    }
+}
+
+static void widenRowScalar(const uint32_t *colors, uint32_t *pixels, uint32_t scale) {
+    for(int x=0; x<256; ++x) {
+        for(uint32_t i=0; i<scale; ++i) {
+            *pixels++ = colors[x];
+        }
+    }
+}
+
+#ifdef NESLIG_X86_KERNELS
+
+// SSE2 has no gather, so converting stays scalar and only widening uses
+// vectors. Scales other than 2 store a whole vector of copies per color and
+// let the next color overwrite the excess, the last colors of the row are
+// copied one by one so nothing is written past the row.
+__attribute__((target("sse2")))
+static void widenRowSSE2(const uint32_t *colors, uint32_t *pixels, uint32_t scale) {
+    int x = 0;
+    if( scale == 2 ) {
+        for(; x<256; x+=4) {
+            __m128i color = _mm_loadu_si128((const __m128i*)(colors+x));
+            _mm_storeu_si128((__m128i*)(pixels+2*x), _mm_unpacklo_epi32(color, color));
+            _mm_storeu_si128((__m128i*)(pixels+2*x+4), _mm_unpackhi_epi32(color, color));
+        }
+        return;
+    }
+
+    uint32_t span = (scale+3) & ~3;
+    for(; x*scale + span <= 256*scale; ++x) {
+        __m128i color = _mm_set1_epi32(colors[x]);
+        for(uint32_t i=0; i<span; i+=4) {
+            _mm_storeu_si128((__m128i*)(pixels + x*scale + i), color);
+        }
+    }
+    for(; x<256; ++x) {
+        for(uint32_t i=0; i<scale; ++i) {
+            pixels[x*scale + i] = colors[x];
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static void convertRowAVX2(const uint8_t *indices, uint32_t *colors) {
+    const __m256i mask = _mm256_set1_epi32(0x3F);
+    for(int x=0; x<256; x+=8) {
+        __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(indices+x)));
+        index = _mm256_and_si256(index, mask);
+        __m256i color = _mm256_i32gather_epi32((const int*)ppu_colors, index, 4);
+        _mm256_storeu_si256((__m256i*)(colors+x), color);
+    }
+}
+
+__attribute__((target("avx2")))
+static void widenRowAVX2(const uint32_t *colors, uint32_t *pixels, uint32_t scale) {
+    int x = 0;
+    if( scale == 2 ) {
+        const __m256i low = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+        const __m256i high = _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7);
+        for(; x<256; x+=8) {
+            __m256i color = _mm256_loadu_si256((const __m256i*)(colors+x));
+            _mm256_storeu_si256((__m256i*)(pixels+2*x), _mm256_permutevar8x32_epi32(color, low));
+            _mm256_storeu_si256((__m256i*)(pixels+2*x+8), _mm256_permutevar8x32_epi32(color, high));
+        }
+        return;
+    }
+
+    uint32_t span = (scale+7) & ~7;
+    for(; x*scale + span <= 256*scale; ++x) {
+        __m256i color = _mm256_set1_epi32(colors[x]);
+        for(uint32_t i=0; i<span; i+=8) {
+            _mm256_storeu_si256((__m256i*)(pixels + x*scale + i), color);
+        }
+    }
+    for(; x<256; ++x) {
+        for(uint32_t i=0; i<scale; ++i) {
+            pixels[x*scale + i] = colors[x];
+        }
+    }
+}
+
+#endif // NESLIG_X86_KERNELS
+
+static VideoKernels selectKernels() {
+#ifdef NESLIG_X86_KERNELS
+    __builtin_cpu_init();
+    if( __builtin_cpu_supports("avx2") ) {
+        return { "avx2", convertRowAVX2, widenRowAVX2 };
+    }
+    if( __builtin_cpu_supports("sse2") ) {
+        return { "sse2", convertRowScalar, widenRowSSE2 };
+    }
+#endif
+    return { "scalar", convertRowScalar, widenRowScalar };
+}
+
+static const VideoKernels &getKernels() {
+    static const VideoKernels kernels = selectKernels();
+    return kernels;
+}
+
+const char *VideoKernelName() {
+    return getKernels().name;
+}
+
+/******************
+* filters
+******************/
+
+// Rows of colors with one extra pixel on each side, repeating the edge
+// pixels, so the filters can look at neighbours without bounds checks
+typedef uint32_t FilterRow[258];
+
+static void convertFilterRow(const uint8_t *frame, int y, FilterRow &row) {
+    y = y < 0 ? 0 : (y > 239 ? 239 : y);
+    getKernels().convert(frame + y*256, row+1);
+    row[0] = row[1];
+    row[257] = row[256];
+}
+
+// For every pixel E, with B above, D left, F right and H below:
+//   E0 E1
+//   E2 E3
+static void scale2xFrame(const uint8_t *frame, uint32_t *pixels, uint32_t pitch) {
+    FilterRow rows[3];
+    convertFilterRow(frame, -1, rows[0]);
+    convertFilterRow(frame, 0, rows[1]);
+    for(int y=0; y<240; ++y) {
+        const uint32_t *above = rows[y % 3];
+        const uint32_t *center = rows[(y+1) % 3];
+        const uint32_t *below = rows[(y+2) % 3];
+        convertFilterRow(frame, y+1, rows[(y+2) % 3]);
+
+        uint32_t *top = pixels + (2*y)*pitch;
+        uint32_t *bottom = top + pitch;
+        for(int x=1; x<=256; ++x) {
+            uint32_t B = above[x], D = center[x-1], E = center[x], F = center[x+1], H = below[x];
+            if( B != H && D != F ) {
+                top[0] = D == B ? D : E;
+                top[1] = B == F ? F : E;
+                bottom[0] = D == H ? D : E;
+                bottom[1] = H == F ? F : E;
+            }
+            else {
+                top[0] = top[1] = bottom[0] = bottom[1] = E;
+            }
+            top += 2;
+            bottom += 2;
+        }
+    }
+}
+
+// Same neighbours as scale2xFrame(), plus the corners A, C, G and I:
+//   E0 E1 E2
+//   E3 E4 E5
+//   E6 E7 E8
+static void scale3xFrame(const uint8_t *frame, uint32_t *pixels, uint32_t pitch) {
+    FilterRow rows[3];
+    convertFilterRow(frame, -1, rows[0]);
+    convertFilterRow(frame, 0, rows[1]);
+    for(int y=0; y<240; ++y) {
+        const uint32_t *above = rows[y % 3];
+        const uint32_t *center = rows[(y+1) % 3];
+        const uint32_t *below = rows[(y+2) % 3];
+        convertFilterRow(frame, y+1, rows[(y+2) % 3]);
+
+        uint32_t *out[3] = { pixels + (3*y)*pitch, pixels + (3*y+1)*pitch, pixels + (3*y+2)*pitch };
+        for(int x=1; x<=256; ++x) {
+            uint32_t A = above[x-1], B = above[x], C = above[x+1];
+            uint32_t D = center[x-1], E = center[x], F = center[x+1];
+            uint32_t G = below[x-1], H = below[x], I = below[x+1];
+
+            uint32_t E0 = E, E1 = E, E2 = E, E3 = E, E5 = E, E6 = E, E7 = E, E8 = E;
+            if( B != H && D != F ) {
+                E0 = D == B ? D : E;
+                E1 = (D == B && E != C) || (B == F && E != A) ? B : E;
+                E2 = B == F ? F : E;
+                E3 = (D == B && E != G) || (D == H && E != A) ? D : E;
+                E5 = (B == F && E != I) || (H == F && E != C) ? F : E;
+                E6 = D == H ? D : E;
+                E7 = (D == H && E != I) || (H == F && E != G) ? H : E;
+                E8 = H == F ? F : E;
+            }
+
+            out[0][0] = E0; out[0][1] = E1; out[0][2] = E2;
+            out[1][0] = E3; out[1][1] = E;  out[1][2] = E5;
+            out[2][0] = E6; out[2][1] = E7; out[2][2] = E8;
+            out[0] += 3;
+            out[1] += 3;
+            out[2] += 3;
+        }
+    }
+}
+
+/******************
+* frames
+******************/
+
+void ConvertFrame(const uint8_t *frame, uint32_t *pixels, uint32_t pitch) {
+    const VideoKernels &kernels = getKernels();
+    for(int y=0; y<240; ++y) {
+        kernels.convert(frame + y*256, pixels + y*pitch);
+    }
+}
+
+uint32_t FilterScale(VideoFilter filter) {
+    switch(filter) {
+        case VideoFilter::Scale2x:
+            return 2;
+        case VideoFilter::Scale3x:
+            return 3;
+        default:
+            return 0;
+    }
+}
+
+bool ParseVideoFilter(const char *name, VideoFilter &filter) {
+    if( strcmp(name, "none") == 0 ) {
+        filter = VideoFilter::None;
+    }
+    else if( strcmp(name, "scale2x") == 0 ) {
+        filter = VideoFilter::Scale2x;
+    }
+    else if( strcmp(name, "scale3x") == 0 ) {
+        filter = VideoFilter::Scale3x;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+bool ScaleFrame(const uint8_t *frame, uint32_t *pixels, uint32_t pitch, uint32_t scale, VideoFilter filter) {
+    if( scale < 1 || scale > max_video_scale ) {
+        return false;
+    }
+    if( filter != VideoFilter::None ) {
+        if( FilterScale(filter) != scale ) {
+            return false;
+        }
+        if( filter == VideoFilter::Scale2x ) {
+            scale2xFrame(frame, pixels, pitch);
+        }
+        else {
+            scale3xFrame(frame, pixels, pitch);
+        }
+        return true;
+    }
+
+    if( scale == 1 ) {
+        ConvertFrame(frame, pixels, pitch);
+        return true;
+    }
+
+    // every row is widened once and then copied to the rows below it
+    const VideoKernels &kernels = getKernels();
+    uint32_t colors[256];
+    for(int y=0; y<240; ++y) {
+        uint32_t *row = pixels + (y*scale)*pitch;
+        kernels.convert(frame + y*256, colors);
+        kernels.widen(colors, row, scale);
+        for(uint32_t i=1; i<scale; ++i) {
+            memcpy(row + i*pitch, row, 256*scale*sizeof(uint32_t));
+        }
+    }
+    return true;
+}
@@ -0,0 +1,39 @@
+#ifndef VIDEO_H_INCLUDED
+#define VIDEO_H_INCLUDED
+
+#include <stdint.h>
+
+// RGB colors (0xRRGGBB) of the 64 NES palette indices
+extern const uint32_t ppu_colors[64];
+
+// How ScaleFrame() enlarges a frame. Scale2x and Scale3x (also known as
+// AdvMAME2x/3x) round off diagonal edges, and only work at a scale of 2
+// and 3 respectively.
+enum class VideoFilter {
+    None,
+    Scale2x,
+    Scale3x
+};
+
+static const uint32_t max_video_scale = 6;
+
+// Converts a 256x240 frame of palette indices, as rendered by the PPU, into
+// 0xRRGGBB pixels. pitch is the number of pixels per row of the output.
+void ConvertFrame(const uint8_t *frame, uint32_t *pixels, uint32_t pitch);
+
+// Like ConvertFrame(), but every NES pixel becomes scale x scale output
+// pixels, so the output is 256*scale x 240*scale. Returns false if scale
+// is not between 1 and max_video_scale, or does not suit the filter.
+bool ScaleFrame(const uint8_t *frame, uint32_t *pixels, uint32_t pitch, uint32_t scale, VideoFilter filter = VideoFilter::None);
+
+// The scale a filter works at, or 0 for VideoFilter::None
+uint32_t FilterScale(VideoFilter filter);
+
+// Parses "none", "scale2x" or "scale3x"
+bool ParseVideoFilter(const char *name, VideoFilter &filter);
+
+// Name of the instruction set ConvertFrame() and ScaleFrame() picked for
+// this CPU: "avx2", "sse2" or "scalar"
+const char *VideoKernelName();
+
+#endif // VIDEO_H_INCLUDED